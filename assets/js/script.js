@@ -1,5 +1,5 @@
 let socket;
-let locationSocket;
+let locationWatchId = null;
 let map;
 
 // DOM Elements
@@ -9,8 +9,14 @@ const inputUsername = document.getElementById("username-input");
 const messagesDiv = document.getElementById("messages");
 const inputMessage = document.getElementById("message-input");
 const sendMessageButton = document.getElementById("send-message-button");
+const inputSearch = document.getElementById("search-input");
+const searchButton = document.getElementById("search-button");
+const searchMoreButton = document.getElementById("search-more-button");
 
 let markers = {}; // Store markers for connected users
+let tracks = {}; // Store replayed movement history per user
+let searchQuery = ""; // Query of the last search, used by "More"
+let searchNextBefore = -1; // Seq to continue from, -1 when there are no older results
 
 // Initialize Map
 map = L.map('map').setView([-6.871382, 107.571098], 17);
@@ -26,9 +32,8 @@ function connect() {
         return;
     }
 
+    // One connection carries both chat and location, tagged by "channel"
     socket = new WebSocket("ws://174.138.26.104:8080");
-    locationSocket = new WebSocket("ws://139.59.101.121:8080");;
-
 
     socket.onopen = () => {
         appendMessage("Connected to the server.", "info");
@@ -39,17 +44,18 @@ function connect() {
 
         updateButtonVisibility(true);
         sendMessageButton.disabled = false;
+        validateSearch();
+
+        startLocationUpdates(username);
     };
 
     socket.onmessage = (event) => {
         const data = JSON.parse(event.data);
 
-        if(data.type == "error") {
-            appendMessage(data.message, "error");
-        } else if(data.type == "announcement") {
-            appendMessage(`${data.username} telah bergabung!`, "info");
+        if (data.channel === "location") {
+            handleLocationMessage(data);
         } else {
-            appendMessage(`<span class="username">${data.username}</span> ${data.message} <span class="time">${data.time}</span>`, "user");
+            handleChatMessage(data);
         }
     };
 
@@ -57,52 +63,77 @@ function connect() {
         appendMessage("Disconnected from the server.", "info");
         updateButtonVisibility(false);
         sendMessageButton.disabled = true;
+        searchButton.disabled = true;
+        searchMoreButton.disabled = true;
+        stopLocationUpdates();
     };
 
     socket.onerror = (error) => {
         appendMessage("Error: " + error.message, "error");
     };
+}
 
-    // Location socket connection
-    locationSocket.onopen = () => {
-        // Update client's own location on the map
-        if (navigator.geolocation) {
-            navigator.geolocation.getCurrentPosition((position) => {
-                const lat = position.coords.latitude;
-                const lng = position.coords.longitude;
-                updateMarker(username, lat, lng);
-
-                // Send the initial location to the server
-                const locationMessage = {username, lat, lon: lng };
-                locationSocket.send(JSON.stringify(locationMessage));
-            });
-        }
+function handleChatMessage(data) {
+    if(data.type == "error") {
+        appendMessage(data.message, "error");
+    } else if(data.type == "announcement") {
+        appendMessage(`${data.username} telah bergabung!`, "info");
+    } else if(data.type == "search_result") {
+        showSearchResults(data);
+    } else {
+        appendMessage(`<span class="username">${data.username}</span> ${data.message} <span class="time">${data.time}</span>`, "user");
+    }
+}
 
-        // Watch for location changes and update the server
-        navigator.geolocation.watchPosition((position) => {
-            const lat = position.coords.latitude;
-            const lng = position.coords.longitude;
+function handleLocationMessage(data) {
+    if (data.type === "track") {
+        showTrack(data);
+        return;
+    }
+    const { username, lat, lon } = data;
+    updateMarker(username, lat, lon);
+}
 
-            // Send the updated location to the server
-            const locationMessage = { username, lat, lon: lng };
-            locationSocket.send(JSON.stringify(locationMessage));
+function sendLocation(username, lat, lng) {
+    if (socket && socket.readyState === WebSocket.OPEN) {
+        const locationMessage = { channel: "location", username, lat, lon: lng };
+        socket.send(JSON.stringify(locationMessage));
+    }
+}
 
-            // Update marker on map
-            updateMarker(username, lat, lng);
-        }, (error) => {
-            console.error("Error getting location: ", error);
-        });
-    };
+function startLocationUpdates(username) {
+    if (!navigator.geolocation) return;
 
-    locationSocket.onmessage = (event) => {
-        const data = JSON.parse(event.data);
-        const { username, lat, lon } = data;
-        updateMarker(username, lat, lon);
-    };
+    // Update client's own location on the map
+    navigator.geolocation.getCurrentPosition((position) => {
+        const lat = position.coords.latitude;
+        const lng = position.coords.longitude;
+        updateMarker(username, lat, lng);
 
-    locationSocket.onerror = (error) => {
-        appendMessage("Location error: " + error.message, "error");
-    };
+        // Send the initial location to the server
+        sendLocation(username, lat, lng);
+    });
+
+    // Watch for location changes and update the server
+    locationWatchId = navigator.geolocation.watchPosition((position) => {
+        const lat = position.coords.latitude;
+        const lng = position.coords.longitude;
+
+        // Send the updated location to the server
+        sendLocation(username, lat, lng);
+
+        // Update marker on map
+        updateMarker(username, lat, lng);
+    }, (error) => {
+        console.error("Error getting location: ", error);
+    });
+}
+
+function stopLocationUpdates() {
+    if (locationWatchId !== null) {
+        navigator.geolocation.clearWatch(locationWatchId);
+        locationWatchId = null;
+    }
 }
 
 function disconnect() {
@@ -120,7 +151,7 @@ function updateMarker(username, lat, lng) {
         map.removeLayer(markers[username]);
     }
 
-    const marker = L.marker([lat, lng]).addTo(map).bindPopup(`${username}`);
+    const marker = L.marker([lat, lng]).addTo(map).bindPopup(markerPopup(username));
     markers[username] = marker;
 
     // Adjust the map view to show all markers
@@ -128,6 +159,43 @@ function updateMarker(username, lat, lng) {
     map.fitBounds(group.getBounds());
 }
 
+// Popup content: username and a button that replays the user's movement history
+function markerPopup(username) {
+    const popup = document.createElement("div");
+    const name = document.createElement("div");
+    name.textContent = username;
+
+    const trackButton = document.createElement("button");
+    trackButton.className = "track-button";
+    trackButton.textContent = "Show track";
+    trackButton.addEventListener("click", () => requestTrack(username));
+
+    popup.append(name, trackButton);
+    return popup;
+}
+
+// Request movement history of a user (time range in ms since epoch)
+function requestTrack(username, from = 0, to = Date.now(), maxPoints = 1000) {
+    if (socket && socket.readyState === WebSocket.OPEN) {
+        if (tracks[username]) {
+            map.removeLayer(tracks[username]);
+        }
+        tracks[username] = L.polyline([]).addTo(map);
+        socket.send(JSON.stringify({ channel: "location", type: "track", username, from, to, max_points: maxPoints }));
+    }
+}
+
+// Track results arrive in chunks until done is true
+function showTrack(data) {
+    const line = tracks[data.username];
+    if (!line) return;
+
+    data.points.forEach(([time, lat, lon]) => line.addLatLng([lat, lon]));
+    if (data.done && line.getLatLngs().length > 0) {
+        map.fitBounds(line.getBounds());
+    }
+}
+
 // Send Message with time
 function sendMessage() {
     const message = inputMessage.value.trim();
@@ -135,6 +203,7 @@ function sendMessage() {
 
     if (message && socket && socket.readyState === WebSocket.OPEN) {
         const chatMessage = {
+            channel: "chat",
             type: "message",
             username,
             message,
@@ -150,6 +219,32 @@ function sendMessage() {
     }
 }
 
+// Search chat history (server-side index, newest first)
+function searchMessages(query, before = -1) {
+    if (query && socket && socket.readyState === WebSocket.OPEN) {
+        searchQuery = query;
+        searchMoreButton.disabled = true;
+        socket.send(JSON.stringify({ channel: "chat", type: "search", query, before, limit: 20 }));
+    }
+}
+
+// Next page of older results, continuing from next_before of the previous page
+function searchMore() {
+    if (searchNextBefore >= 0) {
+        searchMessages(searchQuery, searchNextBefore);
+    }
+}
+
+function showSearchResults(data) {
+    appendMessage(`Hasil pencarian "${data.query}": ${data.results.length} pesan`, "info");
+    data.results.forEach((result) => {
+        appendMessage(`<span class="username">${result.username}</span> ${result.message} <span class="time">${result.time}</span>`, "user");
+    });
+
+    searchNextBefore = data.next_before;
+    searchMoreButton.disabled = searchNextBefore < 0;
+}
+
 // Append Message to Chat
 function appendMessage(message, type = "message") {
     const newMessage = document.createElement("div");
@@ -198,3 +293,10 @@ function validateMessage() {
 }
 
 inputMessage.addEventListener("input", validateMessage);
+
+function validateSearch() {
+    const query = inputSearch.value.trim();
+    searchButton.disabled = !query || !socket || socket.readyState !== WebSocket.OPEN;
+}
+
+inputSearch.addEventListener("input", validateSearch);
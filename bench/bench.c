@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "bench.h"
+
+long bench_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000L;
+}
+
+// MAP_SHARED agar proses klien hasil fork bisa menulis ke tempat yang sama
+bench_samples *bench_samples_create(long capacity) {
+    size_t size = sizeof(bench_samples) + capacity * sizeof(long);
+    bench_samples *samples = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (samples == MAP_FAILED) {
+        perror("Failed to allocate samples");
+        exit(1);
+    }
+    samples->count = 0;
+    samples->capacity = capacity;
+    return samples;
+}
+
+void bench_samples_add(bench_samples *samples, long value) {
+    long index = __sync_fetch_and_add(&samples->count, 1);
+    if (index < samples->capacity) samples->values[index] = value;
+}
+
+void bench_samples_reset(bench_samples *samples) {
+    samples->count = 0;
+}
+
+static int compare_long(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+// Mengurutkan sampel di tempat; return -1 jika belum ada sampel
+long bench_percentile(bench_samples *samples, int percentile) {
+    long count = samples->count < samples->capacity ? samples->count : samples->capacity;
+    if (count == 0) return -1;
+
+    qsort(samples->values, count, sizeof(long), compare_long);
+    long index = count * percentile / 100;
+    return samples->values[index < count ? index : count - 1];
+}
+
+void bench_print_latency(const char *label, bench_samples *samples) {
+    long p50 = bench_percentile(samples, 50);
+    long p99 = bench_percentile(samples, 99);
+    printf("%-24s n=%-7ld p50=%8.2f ms  p99=%8.2f ms\n", label, samples->count, p50 / 1000.0, p99 / 1000.0);
+}
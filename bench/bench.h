@@ -0,0 +1,21 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+
+// Kumpulan sampel latensi (mikrodetik) di memori bersama, bisa diisi banyak proses sekaligus
+typedef struct {
+    long count;
+    long capacity;
+    long values[];
+} bench_samples;
+
+// Deklarasi fungsi yang ada di bench.c
+long bench_now_us(void);
+bench_samples *bench_samples_create(long capacity);
+void bench_samples_add(bench_samples *samples, long value);
+void bench_samples_reset(bench_samples *samples);
+long bench_percentile(bench_samples *samples, int percentile);
+void bench_print_latency(const char *label, bench_samples *samples);
+
+#endif
@@ -0,0 +1,160 @@
+// Benchmark memori per koneksi: buka N klien ke server yang sedang berjalan, lalu hitung
+// proses dan PSS yang bertambah di pohon proses server. Bandingkan ./server (satu koneksi
+// per pengguna) dengan ./server --chat + ./server --location (dua koneksi per pengguna).
+//
+// Pemakaian: ./connmem <clients> <pid>:<port> [<pid>:<port> ...]
+// Setiap klien menyambung ke semua port yang diberikan dengan username yang sama.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "ws_client.h"
+
+#define MAX_SERVERS 4
+#define MAX_PROCESSES 65536
+#define SETTLE_SEC 2   // Beri waktu server selesai fork proses pembaca/pengirim
+
+struct tree_usage {
+    long processes;
+    long pss_kb;
+};
+
+static pid_t parent_of(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE *file = fopen(path, "r");
+    if (!file) return -1;
+
+    // Nama proses di dalam kurung bisa memuat spasi, jadi mulai dari kurung tutup terakhir
+    char line[1024];
+    int ppid = -1;
+    if (fgets(line, sizeof(line), file)) {
+        char *end = strrchr(line, ')');
+        if (end) sscanf(end + 2, "%*c %d", &ppid);
+    }
+    fclose(file);
+    return ppid;
+}
+
+static long pss_of(pid_t pid) {
+    char path[64], line[256];
+    long pss = 0;
+    snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", (int)pid);
+    FILE *file = fopen(path, "r");
+    if (!file) return 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "Pss: %ld kB", &pss) == 1) break;
+    }
+    fclose(file);
+    return pss;
+}
+
+// Jumlahkan root dan semua turunannya; pohon dibangun dari ppid di /proc
+static struct tree_usage measure_tree(pid_t root) {
+    static pid_t pids[MAX_PROCESSES], parents[MAX_PROCESSES];
+    static char in_tree[MAX_PROCESSES];
+    struct tree_usage usage = { 0, 0 };
+    int count = 0;
+
+    DIR *dir = opendir("/proc");
+    if (!dir) return usage;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && count < MAX_PROCESSES) {
+        pid_t pid = atoi(entry->d_name);
+        if (pid <= 0) continue;
+        pids[count] = pid;
+        parents[count] = parent_of(pid);
+        in_tree[count] = pid == root;
+        count++;
+    }
+    closedir(dir);
+
+    // Sebarkan tanda keanggotaan sampai tidak ada yang berubah
+    for (int changed = 1; changed;) {
+        changed = 0;
+        for (int i = 0; i < count; i++) {
+            if (in_tree[i]) continue;
+            for (int j = 0; j < count; j++) {
+                if (in_tree[j] && parents[i] == pids[j]) {
+                    in_tree[i] = changed = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (!in_tree[i]) continue;
+        usage.processes++;
+        usage.pss_kb += pss_of(pids[i]);
+    }
+    return usage;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <clients> <pid>:<port> [<pid>:<port> ...]\n", argv[0]);
+        return 1;
+    }
+
+    int clients = atoi(argv[1]);
+    int nservers = argc - 2 < MAX_SERVERS ? argc - 2 : MAX_SERVERS;
+    pid_t pids[MAX_SERVERS];
+    int ports[MAX_SERVERS];
+    for (int s = 0; s < nservers; s++) {
+        int pid;
+        if (sscanf(argv[2 + s], "%d:%d", &pid, &ports[s]) != 2) {
+            fprintf(stderr, "Invalid server %s, expected <pid>:<port>\n", argv[2 + s]);
+            return 1;
+        }
+        pids[s] = pid;
+    }
+
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    struct tree_usage before[MAX_SERVERS], after[MAX_SERVERS];
+    for (int s = 0; s < nservers; s++) before[s] = measure_tree(pids[s]);
+
+    ws_client *connections = calloc((size_t)clients * nservers, sizeof(ws_client));
+    if (!connections) {
+        perror("Failed to allocate clients");
+        return 1;
+    }
+
+    int opened = 0;
+    for (int i = 0; i < clients; i++) {
+        char message[128];
+        snprintf(message, sizeof(message), "{\"type\":\"connect\",\"username\":\"mem-%d\"}", i);
+        for (int s = 0; s < nservers; s++) {
+            ws_client *client = &connections[i * nservers + s];
+            if (ws_client_open(client, "127.0.0.1", ports[s]) < 0 || ws_client_send_text(client, message) < 0) {
+                fprintf(stderr, "Client %d failed to connect to port %d\n", i, ports[s]);
+                client->fd = -1;
+                continue;
+            }
+            opened++;
+        }
+    }
+    sleep(SETTLE_SEC);
+
+    long total_processes = 0, total_pss = 0;
+    for (int s = 0; s < nservers; s++) {
+        after[s] = measure_tree(pids[s]);
+        long processes = after[s].processes - before[s].processes;
+        long pss = after[s].pss_kb - before[s].pss_kb;
+        printf("server %d (port %d): +%ld proses, +%ld KB PSS\n", (int)pids[s], ports[s], processes, pss);
+        total_processes += processes;
+        total_pss += pss;
+    }
+    printf("%d klien, %d koneksi: per pengguna %.2f koneksi, %.2f proses, %.1f KB PSS\n",
+           clients, opened, (double)opened / clients, (double)total_processes / clients, (double)total_pss / clients);
+
+    for (int i = 0; i < clients * nservers; i++) ws_client_close(&connections[i]);
+    free(connections);
+    return 0;
+}
@@ -0,0 +1,178 @@
+// Driver beban untuk batas laju (ratelimit.c): ukur latensi klien normal sebelum dan
+// selama ada klien yang membanjiri server, lalu pastikan hanya pembanjir yang diputus 1008.
+//
+// Pemakaian: ./flood [host] [port] [normal_clients] [flooders] [seconds]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "websocket.h"
+#include "bench.h"
+#include "ws_client.h"
+
+#define PING_INTERVAL_US 100000   // Setiap klien normal mengirim ping 10x per detik
+#define CHAT_INTERVAL_US 500000   // Satu klien normal mengirim chat 2x per detik, di bawah anggaran
+#define FLOOD_BATCH 20            // Pembanjir membaca balasan setiap sekian pesan
+#define MAX_SAMPLES 200000
+
+struct flood_stats {
+    long normal_disconnected;
+    long flooders_closed;
+    long flooder_close_us;
+    long flooder_sent;
+};
+
+static const char *host = "127.0.0.1";
+static int port = 8080;
+static bench_samples *ping_samples, *chat_samples;
+static struct flood_stats *stats;
+
+static int connect_user(ws_client *client, const char *username) {
+    char message[128];
+    if (ws_client_open(client, host, port) < 0) return -1;
+    snprintf(message, sizeof(message), "{\"type\":\"connect\",\"username\":\"%s\"}", username);
+    return ws_client_send_text(client, message);
+}
+
+// Klien normal: ping berkala, dan klien pertama juga mengirim chat bercap waktu
+static void run_normal(const char *username, int speaker, long end_us) {
+    ws_client client;
+    char data[4096];
+    int opcode;
+
+    if (connect_user(&client, username) < 0) {
+        __sync_fetch_and_add(&stats->normal_disconnected, 1);
+        return;
+    }
+
+    long next_ping = bench_now_us(), next_chat = bench_now_us() + 1000000L;
+    while (bench_now_us() < end_us) {
+        long now = bench_now_us();
+        if (now >= next_ping) {
+            ws_client_send(&client, WS_OPCODE_PING, (const char *)&now, sizeof(now));
+            next_ping += PING_INTERVAL_US;
+        }
+        if (speaker && now >= next_chat) {
+            char message[128];
+            snprintf(message, sizeof(message), "{\"channel\":\"chat\",\"type\":\"message\",\"message\":\"t=%ld\"}", now);
+            ws_client_send_text(&client, message);
+            next_chat += CHAT_INTERVAL_US;
+        }
+
+        long wait = (speaker && next_chat < next_ping ? next_chat : next_ping) - bench_now_us();
+        int length = ws_client_recv(&client, &opcode, data, sizeof(data), wait > 0 ? (int)(wait / 1000) : 0);
+        if (length == WS_CLIENT_TIMEOUT) continue;
+        if (length < 0 || opcode == WS_OPCODE_CLOSE) {
+            __sync_fetch_and_add(&stats->normal_disconnected, 1);
+            break;
+        }
+
+        if (opcode == WS_OPCODE_PONG && length == sizeof(long)) {
+            long sent;
+            memcpy(&sent, data, sizeof(sent));
+            bench_samples_add(ping_samples, bench_now_us() - sent);
+        } else if (opcode == WS_OPCODE_TEXT) {
+            char *stamp = strstr(data, "\"message\":\"t=");
+            if (stamp) bench_samples_add(chat_samples, bench_now_us() - strtol(stamp + 13, NULL, 10));
+        }
+    }
+    ws_client_close(&client);
+}
+
+// Pembanjir: chat dan lokasi secepat mungkin sampai server menutup koneksi
+static void run_flooder(const char *username, long end_us) {
+    ws_client client;
+    char data[4096];
+    int opcode;
+    long start = bench_now_us(), sent = 0;
+
+    if (connect_user(&client, username) < 0) return;
+
+    while (bench_now_us() < end_us) {
+        for (int i = 0; i < FLOOD_BATCH; i++, sent++) {
+            const char *message = i % 2 ? "{\"channel\":\"chat\",\"type\":\"message\",\"message\":\"spam\"}"
+                                        : "{\"channel\":\"location\",\"lat\":-6.87,\"lon\":107.57}";
+            if (ws_client_send_text(&client, message) < 0) goto closed;
+        }
+
+        int length;
+        while ((length = ws_client_recv(&client, &opcode, data, sizeof(data), 0)) >= 0) {
+            if (opcode == WS_OPCODE_CLOSE) goto closed;
+        }
+        if (length != WS_CLIENT_TIMEOUT) goto closed;
+    }
+    __sync_fetch_and_add(&stats->flooder_sent, sent);
+    ws_client_close(&client);
+    return;
+
+closed:
+    __sync_fetch_and_add(&stats->flooder_sent, sent);
+    __sync_fetch_and_add(&stats->flooders_closed, 1);
+    __sync_fetch_and_add(&stats->flooder_close_us, bench_now_us() - start);
+    ws_client_close(&client);
+}
+
+static void run_phase(const char *name, int normal_clients, int flooders, int seconds) {
+    char username[64];
+    long end_us = bench_now_us() + seconds * 1000000L;
+
+    bench_samples_reset(ping_samples);
+    bench_samples_reset(chat_samples);
+    memset(stats, 0, sizeof(*stats));
+
+    for (int i = 0; i < normal_clients + flooders; i++) {
+        if (fork() != 0) continue;
+        if (i < normal_clients) {
+            snprintf(username, sizeof(username), "%s-normal-%d", name, i);
+            run_normal(username, i == 0, end_us);
+        } else {
+            snprintf(username, sizeof(username), "%s-flood-%d", name, i - normal_clients);
+            run_flooder(username, end_us);
+        }
+        exit(0);
+    }
+    while (wait(NULL) > 0);
+
+    char label[64];
+    printf("== %s: %d klien normal, %d pembanjir, %d detik\n", name, normal_clients, flooders, seconds);
+    snprintf(label, sizeof(label), "%s ping rtt", name);
+    bench_print_latency(label, ping_samples);
+    snprintf(label, sizeof(label), "%s chat delivery", name);
+    bench_print_latency(label, chat_samples);
+    printf("klien normal terputus: %ld\n", stats->normal_disconnected);
+    if (flooders > 0) {
+        printf("pembanjir ditutup: %ld/%d (rata-rata setelah %.2f s, %ld pesan terkirim)\n",
+               stats->flooders_closed, flooders,
+               stats->flooders_closed ? stats->flooder_close_us / 1e6 / stats->flooders_closed : 0.0,
+               stats->flooder_sent);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int normal_clients = 20, flooders = 4, seconds = 10;
+
+    if (argc > 1) host = argv[1];
+    if (argc > 2) port = atoi(argv[2]);
+    if (argc > 3) normal_clients = atoi(argv[3]);
+    if (argc > 4) flooders = atoi(argv[4]);
+    if (argc > 5) seconds = atoi(argv[5]);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Line buffered agar hasil tidak tercetak ganda oleh proses klien hasil fork
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    ping_samples = bench_samples_create(MAX_SAMPLES);
+    chat_samples = bench_samples_create(MAX_SAMPLES);
+    stats = mmap(NULL, sizeof(*stats), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (stats == MAP_FAILED) {
+        perror("Failed to allocate stats");
+        return 1;
+    }
+
+    run_phase("baseline", normal_clients, 0, seconds);
+    run_phase("flood", normal_clients, flooders, seconds);
+    return 0;
+}
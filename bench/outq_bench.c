@@ -0,0 +1,131 @@
+// Benchmark penjadwal keluar (outq.c): latensi chat saat antrian lokasi jenuh.
+// Pengirim mengisi outq lewat socketpair yang dibaca dengan laju tetap seperti link lambat.
+// Mode fifo memasukkan chat ke antrian lokasi sehingga chat mengantri di belakang lokasi.
+//
+// Pemakaian: ./outq_bench [seconds]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "outq.h"
+#include "bench.h"
+
+#define LINK_BYTES_PER_SEC (2L << 20)  // Laju baca sisi klien: 2 MB/s
+#define SOCKET_BUFFER 16384            // Buffer kernel kecil agar antrian menumpuk di outq
+#define LOCATION_PAYLOAD 3000          // Satu batch update/riwayat lokasi
+#define LOCATION_BACKLOG 64            // Antrian lokasi selalu diisi sampai sepanjang ini
+#define CHAT_PAYLOAD 200
+#define CHAT_INTERVAL_US 5000          // 200 pesan chat per detik
+#define MAX_SAMPLES 100000
+
+// Frame teks WebSocket tanpa mask dengan panjang 16-bit; byte pertama payload menandai kelas,
+// lalu cap waktu kirim untuk frame chat
+static size_t build_frame(char *frame, char kind, size_t payload) {
+    long now = bench_now_us();
+    frame[0] = (char)0x81;
+    frame[1] = 126;
+    frame[2] = (char)(payload >> 8);
+    frame[3] = (char)(payload & 0xFF);
+    memset(frame + 4, 0, payload);
+    frame[4] = kind;
+    memcpy(frame + 5, &now, sizeof(now));
+    return 4 + payload;
+}
+
+// Sisi klien: baca dengan laju link, catat latensi setiap frame chat
+static void run_reader(int fd, bench_samples *chat_latency, long *location_bytes) {
+    unsigned char buffer[65536];
+    size_t length = 0;
+    long received = 0, start = bench_now_us();
+
+    while (1) {
+        ssize_t n = read(fd, buffer + length, sizeof(buffer) - length);
+        if (n <= 0) break;
+        length += n;
+        received += n;
+
+        size_t offset = 0;
+        while (length - offset >= 4) {
+            size_t payload = (size_t)buffer[offset + 2] << 8 | buffer[offset + 3];
+            if (length - offset < 4 + payload) break;
+            if (buffer[offset + 4] == 'C') {
+                long sent;
+                memcpy(&sent, buffer + offset + 5, sizeof(sent));
+                bench_samples_add(chat_latency, bench_now_us() - sent);
+            } else {
+                *location_bytes += 4 + payload;
+            }
+            offset += 4 + payload;
+        }
+        memmove(buffer, buffer + offset, length - offset);
+        length -= offset;
+
+        long due = received * 1000000L / LINK_BYTES_PER_SEC;
+        long elapsed = bench_now_us() - start;
+        if (due > elapsed) usleep(due - elapsed);
+    }
+}
+
+static void run_mode(const char *mode, int fifo, int seconds) {
+    bench_samples *chat_latency = bench_samples_create(MAX_SAMPLES);
+    long *location_bytes = mmap(NULL, sizeof(long), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    int sockets[2], size = SOCKET_BUFFER;
+
+    if (location_bytes == MAP_FAILED) {
+        perror("Failed to allocate counter");
+        exit(1);
+    }
+    *location_bytes = 0;
+    socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+    setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    setsockopt(sockets[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    long start = bench_now_us();
+    if (fork() == 0) {
+        close(sockets[0]);
+        run_reader(sockets[1], chat_latency, location_bytes);
+        exit(0);
+    }
+    close(sockets[1]);
+
+    struct outq queue;
+    char frame[4 + LOCATION_PAYLOAD];
+    outq_init(&queue, NULL, NULL);
+    long end = start + seconds * 1000000L, next_chat = start;
+    while (bench_now_us() < end) {
+        while (outq_length(&queue, OUTQ_LOCATION) < LOCATION_BACKLOG) {
+            size_t length = build_frame(frame, 'L', LOCATION_PAYLOAD);
+            outq_push(&queue, OUTQ_LOCATION, NULL, frame, length);
+        }
+        if (bench_now_us() >= next_chat) {
+            size_t length = build_frame(frame, 'C', CHAT_PAYLOAD);
+            outq_push(&queue, fifo ? OUTQ_LOCATION : OUTQ_CHAT, NULL, frame, length);
+            next_chat += CHAT_INTERVAL_US;
+        }
+
+        outq_write(&queue, sockets[0]);
+        struct pollfd writable = { sockets[0], POLLOUT, 0 };
+        poll(&writable, 1, 1);
+    }
+    close(sockets[0]);
+    wait(NULL);
+    outq_free(&queue);
+
+    char label[64];
+    snprintf(label, sizeof(label), "%s chat latency", mode);
+    bench_print_latency(label, chat_latency);
+    printf("%-24s %.2f MB/s\n", "location throughput", *location_bytes / ((bench_now_us() - start) / 1e6) / 1048576);
+}
+
+int main(int argc, char *argv[]) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 5;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    run_mode("outq", 0, seconds);
+    run_mode("fifo", 1, seconds);
+    return 0;
+}
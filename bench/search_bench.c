@@ -0,0 +1,159 @@
+// Benchmark indeks pencarian chat (search_index.c): laju tambah pesan, biaya merge per putaran,
+// ukuran indeks, dan latensi query per halaman untuk term umum, term jarang, dan dua term.
+// Teks pesan sintetis dengan distribusi kata Zipf. Berjalan di direktori sementara agar data/
+// milik server tidak tersentuh.
+//
+// Pemakaian: ./search_bench [messages] [messages per merge]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "search_index.h"
+#include "bench.h"
+
+#define VOCABULARY 50000
+#define WORDS_PER_MESSAGE 8
+#define PAGE_SIZE 20          // Sama dengan SEARCH_PAGE_SIZE di server
+#define QUERY_RUNS 200
+
+static double cumulative[VOCABULARY];
+
+// Peringkat kata Zipf (s = 1): peringkat 0 paling sering muncul
+static int zipf_word(void) {
+    double u = (double)rand() / RAND_MAX;
+    int low = 0, high = VOCABULARY - 1;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (cumulative[mid] < u) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+static long index_size(int *nsegments) {
+    DIR *dir = opendir("data");
+    struct dirent *entry;
+    struct stat st;
+    char path[300];
+    long size = 0;
+
+    *nsegments = 0;
+    while (dir && (entry = readdir(dir))) {
+        if (strncmp(entry->d_name, "chats.idx.seg.", 14) != 0) continue;
+        snprintf(path, sizeof(path), "data/%s", entry->d_name);
+        if (stat(path, &st) == 0) size += st.st_size;
+        (*nsegments)++;
+    }
+    if (dir) closedir(dir);
+    return size;
+}
+
+// Ukur satu halaman query; before < 0 berarti halaman pertama
+static void measure_query(const char *label, const char *query, long before, bench_samples *samples) {
+    long results[PAGE_SIZE];
+    int count = 0;
+
+    bench_samples_reset(samples);
+    for (int run = 0; run < QUERY_RUNS; run++) {
+        long start = bench_now_us();
+        count = index_search(query, before, PAGE_SIZE, results);
+        bench_samples_add(samples, bench_now_us() - start);
+    }
+    bench_print_latency(label, samples);
+    if (count < PAGE_SIZE) printf("%-24s (hanya %d hasil)\n", "", count);
+}
+
+// Telusuri semua halaman seperti klien yang menekan "lebih lama" sampai habis
+static void measure_paging(const char *label, const char *query, bench_samples *samples) {
+    long results[PAGE_SIZE];
+    long before = -1, total = 0;
+    int count;
+
+    bench_samples_reset(samples);
+    do {
+        long start = bench_now_us();
+        count = index_search(query, before, PAGE_SIZE, results);
+        bench_samples_add(samples, bench_now_us() - start);
+        total += count;
+        if (count > 0) before = results[count - 1];
+    } while (count == PAGE_SIZE);
+    bench_print_latency(label, samples);
+    printf("%-24s %ld hasil\n", "", total);
+}
+
+int main(int argc, char *argv[]) {
+    long messages = argc > 1 ? atol(argv[1]) : 10000000;
+    long batch = argc > 2 ? atol(argv[2]) : 20000;
+    char directory[] = "/tmp/search_bench.XXXXXX";
+    char text[WORDS_PER_MESSAGE * 8 + 1];
+
+    if (messages < 1 || batch < 1) {
+        fprintf(stderr, "Usage: %s [messages] [messages per merge]\n", argv[0]);
+        return 1;
+    }
+    if (!mkdtemp(directory) || chdir(directory) < 0 || mkdir("data", 0755) < 0) {
+        perror("Failed to prepare benchmark directory");
+        return 1;
+    }
+    index_reset();
+
+    double total = 0, sum = 0;
+    for (int i = 0; i < VOCABULARY; i++) total += 1.0 / (i + 1);
+    for (int i = 0; i < VOCABULARY; i++) {
+        sum += 1.0 / (i + 1);
+        cumulative[i] = sum / total;
+    }
+
+    // Merger dijalankan setiap batch pesan, seperti putaran INDEX_MERGE_INTERVAL di server pada laju
+    // batch pesan/detik. Batch terakhir dibiarkan di log, seperti keadaan di antara dua putaran.
+    bench_samples *merges = bench_samples_create(messages / batch + 1);
+    long add_us = 0, merge_us = 0, offset = 0;
+    srand(42);
+    for (long i = 0; i < messages; i++) {
+        int length = 0;
+        for (int w = 0; w < WORDS_PER_MESSAGE; w++) {
+            length += snprintf(text + length, sizeof(text) - length, "%sk%d", w ? " " : "", zipf_word());
+        }
+
+        long start = bench_now_us();
+        index_add_message(offset, text);
+        add_us += bench_now_us() - start;
+        offset += length + 64;
+
+        if ((i + 1) % batch == 0 && i + 1 < messages) {
+            start = bench_now_us();
+            index_merge();
+            long elapsed = bench_now_us() - start;
+            merge_us += elapsed;
+            bench_samples_add(merges, elapsed);
+        }
+    }
+
+    int nsegments;
+    long size = index_size(&nsegments);
+    printf("pesan                    %ld (%d kata, kosakata %d)\n", messages, WORDS_PER_MESSAGE, VOCABULARY);
+    printf("tambah (index_add_message) %.0f pesan/s\n", messages / (add_us / 1e6));
+    printf("merge                    %ld putaran, total %.1f s\n", merges->count, merge_us / 1e6);
+    bench_print_latency("merge per putaran", merges);
+    printf("merge terlama            %.1f ms\n", bench_percentile(merges, 100) / 1000.0);
+    printf("segmen                   %d, %.1f MB (%.2f byte/pesan)\n", nsegments, size / 1e6, (double)size / messages);
+
+    bench_samples *samples = bench_samples_create(messages / PAGE_SIZE + QUERY_RUNS);
+    measure_query("umum, halaman 1", "k0", -1, samples);
+    measure_query("umum, tengah riwayat", "k0", messages / 2, samples);
+    measure_query("jarang, halaman 1", "k20000", -1, samples);
+    measure_query("jarang, tengah riwayat", "k20000", messages / 2, samples);
+    measure_query("dua term, halaman 1", "k0 k1000", -1, samples);
+    measure_query("dua term, tengah riwayat", "k0 k1000", messages / 2, samples);
+    measure_paging("jarang, semua halaman", "k20000", samples);
+
+    index_reset();
+    unlink(INDEX_DOCS_FILE);
+    unlink(INDEX_LOG_FILE);
+    rmdir("data");
+    chdir("/");
+    rmdir(directory);
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Benchmark codec riwayat lokasi (track.c): ukuran per titik, laju tulis, laju decode
+// query, dan hasil downsampling, memakai jejak jalan kaki sintetis.
+// Berjalan di direktori sementara agar data/tracks milik server tidak tersentuh.
+//
+// Pemakaian: ./track_bench [points]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "track.h"
+#include "bench.h"
+
+#define JSON_POINT_BYTES 52   // Kira-kira satu entri {"username":..,"lat":..,"lon":..} di locations.json
+#define RAW_POINT_BYTES 16    // int64 waktu + dua int32 koordinat
+
+static void count_point(const track_point *point, void *context) {
+    (void)point;
+    (*(long *)context)++;
+}
+
+static long file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+static long query_all(const char *username) {
+    long count = 0;
+    track_query(username, 0, INT64_MAX, 0, count_point, &count);
+    return count;
+}
+
+int main(int argc, char *argv[]) {
+    long points = argc > 1 ? atol(argv[1]) : 100000;
+    char directory[] = "/tmp/track_bench.XXXXXX";
+
+    if (!mkdtemp(directory) || chdir(directory) < 0 || mkdir("data", 0755) < 0) {
+        perror("Failed to prepare benchmark directory");
+        return 1;
+    }
+    track_reset();
+
+    // Jalan kaki ~1,4 m/s, sampel tiap ~1 detik dengan jitter waktu dan derau GPS beberapa meter.
+    // Jejak dimulai dua hari lalu agar seluruh blok (kecuali yang aktif) layak dikompaksi.
+    track_writer writer;
+    track_writer_init(&writer, "walker");
+    srand(42);
+    double lat = -6.871382, lon = 107.571098, heading = 0;
+    int64_t t = track_now_ms() - 2 * 24 * 3600 * 1000L;
+
+    long start = bench_now_us();
+    for (long i = 0; i < points; i++) {
+        heading += (rand() % 200 - 100) / 1000.0;
+        lat += 1.4 * cos(heading) / 111320.0;
+        lon += 1.4 * sin(heading) / 110000.0;
+        double noise_lat = (rand() % 400 - 200) / 1e7, noise_lon = (rand() % 400 - 200) / 1e7;
+        t += 1000 + rand() % 100 - 50;
+        if (track_append(&writer, t, lat + noise_lat, lon + noise_lon) < 0) {
+            fprintf(stderr, "track_append failed at point %ld\n", i);
+            return 1;
+        }
+    }
+    long append_us = bench_now_us() - start;
+
+    long size = file_size(writer.path);
+    printf("titik                  %ld\n", points);
+    printf("ukuran file            %ld byte (%.2f byte/titik; raw %d, JSON ~%d)\n",
+           size, (double)size / points, RAW_POINT_BYTES, JSON_POINT_BYTES);
+    printf("tulis (track_append)   %.0f titik/s\n", points / (append_us / 1e6));
+
+    start = bench_now_us();
+    long decoded = query_all("walker");
+    long query_us = bench_now_us() - start;
+    printf("decode (track_query)   %.0f titik/s (%ld titik)\n", decoded / (query_us / 1e6), decoded);
+
+    start = bench_now_us();
+    track_compact(writer.path, track_now_ms() - TRACK_COMPACT_AGE_MS, TRACK_DP_EPSILON_M);
+    long compact_us = bench_now_us() - start;
+    long compacted_size = file_size(writer.path);
+    long remaining = query_all("walker");
+    printf("kompaksi (DP %.1f m)    %.1f ms: %ld -> %ld titik, %ld -> %ld byte\n",
+           TRACK_DP_EPSILON_M, compact_us / 1000.0, decoded, remaining, size, compacted_size);
+
+    track_reset();
+    rmdir(TRACK_DIR);
+    rmdir("data");
+    chdir("/");
+    rmdir(directory);
+    return 0;
+}
@@ -0,0 +1,180 @@
+// Driver upgrade tanpa putus: sambungkan N klien ke server yang sedang berjalan, kirim chat
+// bernomor urut terus-menerus, jalankan `<server> --upgrade` di tengah jalan, lalu pastikan
+// tidak ada klien yang terputus dan setiap pesan diterima tepat satu kali oleh klien lain.
+//
+// Pemakaian (dari direktori yang berisi data/ milik server):
+//   bench/upgrade <server-binary> [port] [clients] [seconds]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <fcntl.h>
+#include "websocket.h"
+#include "upgrade.h"
+#include "bench.h"
+#include "ws_client.h"
+
+#define MAX_CLIENTS 64
+#define MAX_SEQ 1024
+#define SEND_INTERVAL_US 500000L  // 2 pesan per detik per klien, jauh di bawah anggaran chat
+#define JOIN_SETTLE_SEC 2         // chat_poll hanya mengirim pesan setelah detik bergabung
+#define DRAIN_SEC 4               // Tunggu pesan terakhir terkirim setelah pengiriman berhenti
+#define UPGRADE_LOG "data/upgrade.log"  // Output server baru, yang tetap hidup setelah driver selesai
+
+static unsigned char received[MAX_CLIENTS][MAX_CLIENTS][MAX_SEQ];
+
+// Pid proses utama yang tercatat di pid file; berubah jika upgrade benar-benar terjadi
+static int server_pid(int port) {
+    char path[64];
+    int pid = -1;
+    snprintf(path, sizeof(path), UPGRADE_PID_FILE, port);
+
+    FILE *file = fopen(path, "r");
+    if (!file) return -1;
+    if (fscanf(file, "%d", &pid) != 1) pid = -1;
+    fclose(file);
+    return pid;
+}
+
+static pid_t start_upgrade(const char *binary, int port) {
+    char port_text[16];
+    snprintf(port_text, sizeof(port_text), "%d", port);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        int log = open(UPGRADE_LOG, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (log >= 0) {
+            dup2(log, STDOUT_FILENO);
+            dup2(log, STDERR_FILENO);
+            close(log);
+        }
+        execl(binary, binary, "--upgrade", "--port", port_text, (char *)NULL);
+        perror("Failed to start upgrade");
+        _exit(1);
+    }
+    return pid;
+}
+
+// Catat satu frame teks milik klien receiver; return -1 jika koneksi tertutup
+static int handle_frame(int receiver, int opcode, const char *data) {
+    if (opcode == WS_OPCODE_CLOSE) return -1;
+    if (opcode != WS_OPCODE_TEXT) return 0;
+
+    const char *text = strstr(data, "\"message\":\"");
+    int sender, seq;
+    if (text && sscanf(text + 11, "up-%d#%d", &sender, &seq) == 2 &&
+        sender >= 0 && sender < MAX_CLIENTS && seq >= 0 && seq < MAX_SEQ) {
+        if (received[receiver][sender][seq] < 255) received[receiver][sender][seq]++;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <server-binary> [port] [clients] [seconds]\n", argv[0]);
+        return 1;
+    }
+    const char *binary = argv[1];
+    int port = argc > 2 ? atoi(argv[2]) : 8080;
+    int clients = argc > 3 ? atoi(argv[3]) : 10;
+    int seconds = argc > 4 ? atoi(argv[4]) : 20;
+    if (clients > MAX_CLIENTS) clients = MAX_CLIENTS;
+
+    // Proses server baru tetap berjalan setelah driver selesai; tidak perlu di-wait
+    signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    int old_pid = server_pid(port);
+    if (old_pid < 0) {
+        fprintf(stderr, "No pid file for port %d; run from the server's working directory\n", port);
+        return 1;
+    }
+
+    static ws_client connections[MAX_CLIENTS];
+    int alive[MAX_CLIENTS], sent[MAX_CLIENTS];
+    for (int i = 0; i < clients; i++) {
+        char message[128];
+        snprintf(message, sizeof(message), "{\"type\":\"connect\",\"username\":\"up-%d\"}", i);
+        if (ws_client_open(&connections[i], "127.0.0.1", port) < 0 || ws_client_send_text(&connections[i], message) < 0) {
+            fprintf(stderr, "Client %d failed to connect\n", i);
+            return 1;
+        }
+        alive[i] = 1;
+        sent[i] = 0;
+    }
+    sleep(JOIN_SETTLE_SEC);
+
+    long start = bench_now_us();
+    long send_end = start + seconds * 1000000L, end = send_end + DRAIN_SEC * 1000000L;
+    long upgrade_at = start + seconds * 1000000L / 2;
+    long next_send = start;
+    int upgraded = 0;
+
+    while (bench_now_us() < end) {
+        long now = bench_now_us();
+        if (!upgraded && now >= upgrade_at) {
+            printf("menjalankan %s --upgrade (output di %s)\n", binary, UPGRADE_LOG);
+            start_upgrade(binary, port);
+            upgraded = 1;
+        }
+        if (now < send_end && now >= next_send) {
+            for (int i = 0; i < clients; i++) {
+                char message[128];
+                if (!alive[i] || sent[i] >= MAX_SEQ) continue;
+                snprintf(message, sizeof(message), "{\"channel\":\"chat\",\"type\":\"message\",\"message\":\"up-%d#%d\"}", i, sent[i]);
+                if (ws_client_send_text(&connections[i], message) < 0) alive[i] = 0;
+                else sent[i]++;
+            }
+            next_send += SEND_INTERVAL_US;
+        }
+
+        struct pollfd fds[MAX_CLIENTS];
+        for (int i = 0; i < clients; i++) {
+            fds[i].fd = alive[i] ? connections[i].fd : -1;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+        poll(fds, clients, 50);
+
+        for (int i = 0; i < clients; i++) {
+            if (!alive[i] || !(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+            char data[4096];
+            int opcode, length;
+            while ((length = ws_client_recv(&connections[i], &opcode, data, sizeof(data), 0)) >= 0) {
+                if (handle_frame(i, opcode, data) < 0) break;
+            }
+            if (length != WS_CLIENT_TIMEOUT) {
+                printf("klien up-%d terputus\n", i);
+                alive[i] = 0;
+            }
+        }
+    }
+
+    // Setiap pesan klien lain harus diterima tepat sekali; pesan sendiri tidak dikirim balik
+    long disconnected = 0, missing = 0, duplicates = 0, expected = 0;
+    for (int r = 0; r < clients; r++) {
+        if (!alive[r]) disconnected++;
+        for (int s = 0; s < clients; s++) {
+            if (s == r) continue;
+            for (int q = 0; q < sent[s]; q++) {
+                expected++;
+                if (received[r][s][q] == 0) missing++;
+                else if (received[r][s][q] > 1) duplicates += received[r][s][q] - 1;
+            }
+        }
+    }
+
+    int new_pid = server_pid(port);
+    printf("pid server: %d -> %d\n", old_pid, new_pid);
+    printf("%d klien, %ld pengiriman diharapkan: %ld terputus, %ld hilang, %ld ganda\n",
+           clients, expected, disconnected, missing, duplicates);
+    int ok = upgraded && new_pid > 0 && new_pid != old_pid && disconnected == 0 && missing == 0 && duplicates == 0;
+    printf("%s\n", ok ? "OK" : "GAGAL");
+
+    for (int i = 0; i < clients; i++) ws_client_close(&connections[i]);
+    return ok ? 0 : 1;
+}
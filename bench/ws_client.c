@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include "ws_client.h"
+
+static int connect_tcp(const char *host, int port) {
+    struct addrinfo hints, *result;
+    char service[16];
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(service, sizeof(service), "%d", port);
+    if (getaddrinfo(host, service, &hints, &result) != 0) return -1;
+
+    int fd = -1;
+    for (struct addrinfo *address = result; address; address = address->ai_next) {
+        fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd < 0) continue;
+        if (connect(fd, address->ai_addr, address->ai_addrlen) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    return fd;
+}
+
+static int send_all(int fd, const void *data, size_t length) {
+    const char *bytes = data;
+    while (length > 0) {
+        ssize_t sent = send(fd, bytes, length, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return -1;
+        bytes += sent;
+        length -= sent;
+    }
+    return 0;
+}
+
+// Sambung dan handshake; sisa byte setelah header respons disimpan sebagai awal frame pertama
+int ws_client_open(ws_client *client, const char *host, int port) {
+    char request[256];
+
+    client->length = 0;
+    client->fd = connect_tcp(host, port);
+    if (client->fd < 0) return -1;
+
+    int length = snprintf(request, sizeof(request),
+                          "GET / HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n", host);
+    if (send_all(client->fd, request, length) < 0) goto fail;
+
+    char *end = NULL;
+    while (!end) {
+        if (client->length >= sizeof(client->buffer) - 1) goto fail;
+        ssize_t received = recv(client->fd, client->buffer + client->length, sizeof(client->buffer) - 1 - client->length, 0);
+        if (received <= 0) goto fail;
+        client->length += received;
+        client->buffer[client->length] = '\0';
+        end = strstr((char *)client->buffer, "\r\n\r\n");
+    }
+    if (strncmp((char *)client->buffer, "HTTP/1.1 101", 12) != 0) goto fail;
+
+    size_t header_length = end + 4 - (char *)client->buffer;
+    memmove(client->buffer, client->buffer + header_length, client->length - header_length);
+    client->length -= header_length;
+    return 0;
+
+fail:
+    close(client->fd);
+    client->fd = -1;
+    return -1;
+}
+
+// Frame dari klien wajib di-mask; mask tetap sudah cukup untuk benchmark
+int ws_client_send(ws_client *client, int opcode, const char *data, size_t length) {
+    static const unsigned char mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+    unsigned char header[14];
+    size_t header_length = 2;
+
+    header[0] = 0x80 | opcode;
+    if (length < 126) {
+        header[1] = 0x80 | length;
+    } else if (length < 65536) {
+        header[1] = 0x80 | 126;
+        header[2] = length >> 8;
+        header[3] = length & 0xFF;
+        header_length = 4;
+    } else {
+        return -1;
+    }
+    memcpy(header + header_length, mask, 4);
+    header_length += 4;
+
+    unsigned char frame[sizeof(header) + 65536];
+    memcpy(frame, header, header_length);
+    for (size_t i = 0; i < length; i++) frame[header_length + i] = data[i] ^ mask[i % 4];
+    return send_all(client->fd, frame, header_length + length);
+}
+
+int ws_client_send_text(ws_client *client, const char *text) {
+    return ws_client_send(client, 0x1, text, strlen(text));
+}
+
+// Return panjang payload (dipotong ke size - 1 dan diakhiri '\0'), WS_CLIENT_TIMEOUT, atau -1 jika tertutup
+int ws_client_recv(ws_client *client, int *opcode, char *data, size_t size, int timeout_ms) {
+    while (1) {
+        if (client->length >= 2) {
+            size_t offset = 2, length = client->buffer[1] & 0x7F;
+            if (length == 126 && client->length >= 4) {
+                length = (size_t)client->buffer[2] << 8 | client->buffer[3];
+                offset = 4;
+            } else if (length == 127 && client->length >= 10) {
+                length = 0;
+                for (int i = 0; i < 8; i++) length = length << 8 | client->buffer[2 + i];
+                offset = 10;
+            }
+            if (length >= 126 && offset == 2) {
+                // Header panjang belum lengkap
+            } else if (offset + length > sizeof(client->buffer)) {
+                return -1;
+            } else if (client->length >= offset + length) {
+                size_t copy = length < size - 1 ? length : size - 1;
+                *opcode = client->buffer[0] & 0x0F;
+                memcpy(data, client->buffer + offset, copy);
+                data[copy] = '\0';
+                memmove(client->buffer, client->buffer + offset + length, client->length - offset - length);
+                client->length -= offset + length;
+                return (int)copy;
+            }
+        }
+
+        struct pollfd incoming = { client->fd, POLLIN, 0 };
+        int ready = poll(&incoming, 1, timeout_ms);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready == 0) return WS_CLIENT_TIMEOUT;
+        if (ready < 0) return -1;
+
+        ssize_t received = recv(client->fd, client->buffer + client->length, sizeof(client->buffer) - client->length, 0);
+        if (received <= 0) return -1;
+        client->length += received;
+    }
+}
+
+void ws_client_close(ws_client *client) {
+    if (client->fd >= 0) close(client->fd);
+    client->fd = -1;
+}
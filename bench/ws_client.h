@@ -0,0 +1,23 @@
+#ifndef WS_CLIENT_H
+#define WS_CLIENT_H
+
+#include <stddef.h>
+
+#define WS_CLIENT_BUFFER_SIZE 65536
+#define WS_CLIENT_TIMEOUT -2   // ws_client_recv: tidak ada frame utuh sebelum batas waktu
+
+// Klien WebSocket minimal untuk driver benchmark: frame teks/kontrol tanpa fragmentasi
+typedef struct {
+    int fd;
+    unsigned char buffer[WS_CLIENT_BUFFER_SIZE];
+    size_t length;
+} ws_client;
+
+// Deklarasi fungsi yang ada di ws_client.c
+int ws_client_open(ws_client *client, const char *host, int port);
+int ws_client_send(ws_client *client, int opcode, const char *data, size_t length);
+int ws_client_send_text(ws_client *client, const char *text);
+int ws_client_recv(ws_client *client, int *opcode, char *data, size_t size, int timeout_ms);
+void ws_client_close(ws_client *client);
+
+#endif
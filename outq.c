@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include "websocket.h"
+#include "outq.h"
+
+// Bobot deficit round robin antara chat dan lokasi; kontrol tidak ikut DRR
+static const long class_weight[OUTQ_CLASSES] = { 0, 4, 1 };
+static const enum outq_class drr_classes[] = { OUTQ_CHAT, OUTQ_LOCATION };
+#define DRR_CLASS_COUNT 2
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+void outq_init(struct outq *queue, outq_drop_callback on_drop, void *context) {
+    memset(queue, 0, sizeof(*queue));
+    queue->on_drop = on_drop;
+    queue->context = context;
+}
+
+static void append_frame(struct outq *queue, enum outq_class cls, struct outq_frame *frame) {
+    frame->next = NULL;
+    if (queue->tail[cls]) {
+        queue->tail[cls]->next = frame;
+    } else {
+        queue->head[cls] = frame;
+    }
+    queue->tail[cls] = frame;
+    queue->count[cls]++;
+    if (cls == OUTQ_LOCATION && frame->key[0] == '\0') queue->keyless_location_bytes += frame->length;
+}
+
+// Lepas frame dari antrian; prev adalah frame sebelumnya atau NULL jika frame di kepala
+static void unlink_frame(struct outq *queue, enum outq_class cls, struct outq_frame *prev, struct outq_frame *frame) {
+    if (prev) {
+        prev->next = frame->next;
+    } else {
+        queue->head[cls] = frame->next;
+    }
+    if (queue->tail[cls] == frame) queue->tail[cls] = prev;
+    queue->count[cls]--;
+    if (cls == OUTQ_LOCATION && frame->key[0] == '\0') queue->keyless_location_bytes -= frame->length;
+}
+
+static void drop_frame(struct outq *queue, enum outq_class cls, struct outq_frame *prev, struct outq_frame *frame) {
+    unlink_frame(queue, cls, prev, frame);
+    queue->dropped++;
+    if (queue->on_drop) queue->on_drop(queue->context, frame->key);
+    free(frame);
+}
+
+static void discard_class(struct outq *queue, enum outq_class cls) {
+    while (queue->head[cls]) {
+        struct outq_frame *frame = queue->head[cls];
+        unlink_frame(queue, cls, NULL, frame);
+        free(frame);
+    }
+    queue->deficit[cls] = 0;
+}
+
+// Masukkan frame ke antrian kelasnya. Update lokasi dengan kunci yang sama digabung:
+// frame lama diganti isinya tanpa kehilangan posisi antrian.
+int outq_push(struct outq *queue, enum outq_class cls, const char *key, const char *data, size_t length) {
+    if (queue->closed) return 0;
+    if (cls != OUTQ_LOCATION || (key && key[0] == '\0')) key = NULL;
+
+    // Frame lokasi tanpa kunci (potongan riwayat) tidak bisa digabung; jika klien berhenti membaca,
+    // frame baru dibuang agar antrian tidak tumbuh tanpa batas
+    if (cls == OUTQ_LOCATION && !key && queue->keyless_location_bytes + length > OUTQ_LOCATION_BYTES_MAX) {
+        queue->dropped++;
+        return 0;
+    }
+
+    struct outq_frame *frame = malloc(sizeof(*frame) + length);
+    if (!frame) return -1;
+    memcpy(frame->data, data, length);
+    frame->length = length;
+    frame->enqueued_ms = now_ms();
+    frame->close = cls == OUTQ_CONTROL && length > 0 && ((unsigned char)data[0] & 0x0F) == WS_OPCODE_CLOSE;
+    frame->key[0] = '\0';
+    if (key) {
+        strncpy(frame->key, key, OUTQ_KEY_SIZE - 1);
+        frame->key[OUTQ_KEY_SIZE - 1] = '\0';
+
+        struct outq_frame *prev = NULL;
+        for (struct outq_frame *old = queue->head[cls]; old; prev = old, old = old->next) {
+            if (strcmp(old->key, frame->key) != 0) continue;
+
+            // Umur dihitung sejak posisi pertama kali tertunda, bukan sejak diganti
+            frame->enqueued_ms = old->enqueued_ms;
+            frame->next = old->next;
+            if (prev) {
+                prev->next = frame;
+            } else {
+                queue->head[cls] = frame;
+            }
+            if (queue->tail[cls] == old) queue->tail[cls] = frame;
+            free(old);
+            queue->coalesced++;
+            return 0;
+        }
+
+        // Antrian lokasi penuh: buang update posisi tertua
+        if (queue->count[cls] >= OUTQ_LOCATION_MAX) {
+            prev = NULL;
+            for (struct outq_frame *old = queue->head[cls]; old; prev = old, old = old->next) {
+                if (old->key[0] == '\0') continue;
+                drop_frame(queue, cls, prev, old);
+                break;
+            }
+        }
+    }
+
+    append_frame(queue, cls, frame);
+    return 0;
+}
+
+int outq_pending(const struct outq *queue) {
+    if (queue->current) return 1;
+    for (int cls = 0; cls < OUTQ_CLASSES; cls++) {
+        if (queue->head[cls]) return 1;
+    }
+    return 0;
+}
+
+size_t outq_length(const struct outq *queue, enum outq_class cls) {
+    return queue->count[cls];
+}
+
+static struct outq_frame *pop_frame(struct outq *queue, enum outq_class cls) {
+    struct outq_frame *frame = queue->head[cls];
+    unlink_frame(queue, cls, NULL, frame);
+    queue->deficit[cls] -= (long)frame->length;
+    return frame;
+}
+
+// Pilih frame berikutnya: kontrol dulu, lalu chat yang melewati anggaran latensinya,
+// lalu deficit round robin berbobot antara chat dan lokasi
+static struct outq_frame *next_frame(struct outq *queue) {
+    long now = now_ms();
+
+    if (queue->head[OUTQ_CONTROL]) return pop_frame(queue, OUTQ_CONTROL);
+
+    // Update posisi yang sudah basi tidak dikirim; pemilik callback akan mengirim posisi terbaru
+    struct outq_frame *prev = NULL, *frame = queue->head[OUTQ_LOCATION];
+    while (frame) {
+        struct outq_frame *next = frame->next;
+        if (frame->key[0] != '\0' && now - frame->enqueued_ms > OUTQ_LOCATION_BUDGET_MS) {
+            drop_frame(queue, OUTQ_LOCATION, prev, frame);
+        } else {
+            prev = frame;
+        }
+        frame = next;
+    }
+
+    // Defisit boleh negatif di sini; kelebihan itu dibayar pada putaran DRR berikutnya
+    if (queue->head[OUTQ_CHAT] && now - queue->head[OUTQ_CHAT]->enqueued_ms > OUTQ_CHAT_BUDGET_MS) {
+        return pop_frame(queue, OUTQ_CHAT);
+    }
+
+    if (!queue->head[OUTQ_CHAT] && !queue->head[OUTQ_LOCATION]) return NULL;
+
+    while (1) {
+        enum outq_class cls = drr_classes[queue->turn];
+
+        if (!queue->head[cls]) {
+            queue->deficit[cls] = 0;
+        } else {
+            if (!queue->turn_started) {
+                queue->deficit[cls] += OUTQ_QUANTUM * class_weight[cls];
+                queue->turn_started = 1;
+            }
+            if (queue->deficit[cls] >= (long)queue->head[cls]->length) return pop_frame(queue, cls);
+        }
+
+        queue->turn = (queue->turn + 1) % DRR_CLASS_COUNT;
+        queue->turn_started = 0;
+    }
+}
+
+// Kirim sebanyak mungkin tanpa memblokir. Return -1 jika koneksi bermasalah.
+int outq_write(struct outq *queue, int fd) {
+    while (1) {
+        if (!queue->current) {
+            queue->current = next_frame(queue);
+            queue->sent = 0;
+            if (!queue->current) return 0;
+        }
+
+        struct outq_frame *frame = queue->current;
+        ssize_t sent = send(fd, frame->data + queue->sent, frame->length - queue->sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+
+        queue->sent += sent;
+        if (queue->sent < frame->length) continue;
+
+        // Setelah frame close terkirim, sisa data tidak boleh dikirim lagi
+        if (frame->close) {
+            queue->closed = 1;
+            discard_class(queue, OUTQ_CHAT);
+            discard_class(queue, OUTQ_LOCATION);
+        }
+        free(frame);
+        queue->current = NULL;
+    }
+}
+
+// Sisa frame yang baru terkirim sebagian; harus dikirim paling awal oleh pemilik berikutnya
+size_t outq_unsent(const struct outq *queue, const char **data) {
+    if (!queue->current) return 0;
+    *data = queue->current->data + queue->sent;
+    return queue->current->length - queue->sent;
+}
+
+void outq_visit(const struct outq *queue, outq_visitor visitor, void *context) {
+    for (int cls = 0; cls < OUTQ_CLASSES; cls++) {
+        for (struct outq_frame *frame = queue->head[cls]; frame; frame = frame->next) {
+            visitor(context, cls, frame->key, frame->data, frame->length);
+        }
+    }
+}
+
+// Lanjutkan pengiriman sisa frame dari proses lain; byte ini dikirim sebelum frame apa pun
+int outq_resume(struct outq *queue, const char *data, size_t length) {
+    if (queue->current || length == 0) return -1;
+
+    struct outq_frame *frame = malloc(sizeof(*frame) + length);
+    if (!frame) return -1;
+    memcpy(frame->data, data, length);
+    frame->length = length;
+    frame->enqueued_ms = now_ms();
+    frame->close = 0;
+    frame->key[0] = '\0';
+    frame->next = NULL;
+    queue->current = frame;
+    queue->sent = 0;
+    return 0;
+}
+
+void outq_free(struct outq *queue) {
+    for (int cls = 0; cls < OUTQ_CLASSES; cls++) discard_class(queue, cls);
+    free(queue->current);
+    queue->current = NULL;
+}
@@ -0,0 +1,70 @@
+#ifndef OUTQ_H
+#define OUTQ_H
+
+#include <stddef.h>
+
+#define OUTQ_QUANTUM 1024            // Byte per putaran deficit round robin untuk bobot 1
+#define OUTQ_KEY_SIZE 64             // Panjang maksimum kunci penggabungan (username)
+#define OUTQ_CHAT_BUDGET_MS 100      // Chat yang menunggu lebih lama didahulukan dari giliran DRR
+#define OUTQ_LOCATION_BUDGET_MS 2000 // Lokasi yang lebih tua dari ini sudah basi dan dibuang
+#define OUTQ_CHAT_HIGH_WATER 256     // Di atas ini chat_poll ditunda (pesan tetap di chats.json)
+#define OUTQ_LOCATION_MAX 256        // Di atas ini update lokasi tertua dibuang
+#define OUTQ_LOCATION_BYTES_MAX (256 * 1024)  // Batas byte frame lokasi tanpa kunci (riwayat lokasi)
+
+// Kelas trafik keluar, urut dari prioritas tertinggi
+enum outq_class {
+    OUTQ_CONTROL = 0,   // close, pong: selalu dikirim lebih dulu
+    OUTQ_CHAT = 1,      // pesan, pengumuman, error, hasil pencarian
+    OUTQ_LOCATION = 2,  // update posisi (boleh digabung/dibuang) dan riwayat lokasi
+    OUTQ_CLASSES
+};
+
+struct outq_frame {
+    struct outq_frame *next;
+    long enqueued_ms;
+    int close;                  // Frame close: setelah terkirim tidak ada data lain yang boleh menyusul
+    size_t length;
+    char key[OUTQ_KEY_SIZE];    // Kosong jika frame tidak boleh digabung atau dibuang
+    char data[];
+};
+
+// Dipanggil saat update lokasi dengan kunci tertentu dibuang tanpa terkirim
+typedef void (*outq_drop_callback)(void *context, const char *key);
+
+// Antrian keluar satu koneksi, hanya dipakai oleh proses pengirim
+struct outq {
+    struct outq_frame *head[OUTQ_CLASSES];
+    struct outq_frame *tail[OUTQ_CLASSES];
+    size_t count[OUTQ_CLASSES];
+    size_t keyless_location_bytes;
+    long deficit[OUTQ_CLASSES];
+    int turn;
+    int turn_started;
+
+    // Frame yang sedang dikirim; frame WebSocket tidak boleh diselingi frame lain
+    struct outq_frame *current;
+    size_t sent;
+    int closed;
+
+    outq_drop_callback on_drop;
+    void *context;
+
+    unsigned long coalesced;
+    unsigned long dropped;
+};
+
+// Dipanggil untuk setiap frame yang masih antri, urut kelas lalu urut kedatangan
+typedef void (*outq_visitor)(void *context, enum outq_class cls, const char *key, const char *data, size_t length);
+
+// Deklarasi fungsi yang ada di outq.c
+void outq_init(struct outq *queue, outq_drop_callback on_drop, void *context);
+int outq_push(struct outq *queue, enum outq_class cls, const char *key, const char *data, size_t length);
+int outq_pending(const struct outq *queue);
+size_t outq_length(const struct outq *queue, enum outq_class cls);
+int outq_write(struct outq *queue, int fd);
+size_t outq_unsent(const struct outq *queue, const char **data);
+void outq_visit(const struct outq *queue, outq_visitor visitor, void *context);
+int outq_resume(struct outq *queue, const char *data, size_t length);
+void outq_free(struct outq *queue);
+
+#endif
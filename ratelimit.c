@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include "ratelimit.h"
+
+#define USERNAME_KEY_SIZE 64
+#define USER_PROBE_LIMIT 16
+
+// Anggaran per jenis trafik: laju isi ulang (token/detik) dan kapasitas burst
+static const long rate_per_sec[RATE_KINDS] = { 5, 2 };
+static const long rate_burst[RATE_KINDS] = { 10, 5 };
+
+struct user_slot {
+    unsigned int hash;
+    char username[USERNAME_KEY_SIZE];
+    token_bucket buckets[RATE_KINDS];
+};
+
+// State bersama antar proses hasil fork(), ukurannya tetap sejak awal
+struct admission_state {
+    pthread_mutex_t lock;
+    int active;
+    int handshaking;
+    struct user_slot users[USER_BUCKET_SLOTS];
+};
+
+static struct admission_state *state = NULL;
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+// FNV-1a, cukup untuk menyebar username ke slot tabel
+static unsigned int hash_username(const char *username) {
+    unsigned int hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)username; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void bucket_fill(token_bucket *bucket, enum rate_kind kind, long now) {
+    bucket->tokens = rate_burst[kind] * 1000;
+    bucket->last_ms = now;
+}
+
+// Isi ulang bucket sesuai waktu yang berlalu, lalu ambil satu token jika ada
+static int bucket_take(token_bucket *bucket, enum rate_kind kind, long now) {
+    long capacity = rate_burst[kind] * 1000;
+    long elapsed = now - bucket->last_ms;
+
+    if (elapsed > 0) {
+        bucket->tokens += elapsed * rate_per_sec[kind];
+        if (bucket->tokens > capacity) bucket->tokens = capacity;
+        bucket->last_ms = now;
+    }
+
+    if (bucket->tokens < 1000) return 0;
+    bucket->tokens -= 1000;
+    return 1;
+}
+
+static long slot_last_used(const struct user_slot *slot) {
+    long last = 0;
+    for (int kind = 0; kind < RATE_KINDS; kind++) {
+        if (slot->buckets[kind].last_ms > last) last = slot->buckets[kind].last_ms;
+    }
+    return last;
+}
+
+// Cari slot milik username; jika belum ada, pakai slot kosong atau yang paling lama diam
+static struct user_slot *find_user_slot(const char *username, long now) {
+    unsigned int hash = hash_username(username);
+    struct user_slot *victim = NULL;
+
+    for (int i = 0; i < USER_PROBE_LIMIT; i++) {
+        struct user_slot *slot = &state->users[(hash + i) % USER_BUCKET_SLOTS];
+
+        if (slot->username[0] == '\0') {
+            if (!victim || victim->username[0] != '\0') victim = slot;
+            continue;
+        }
+        if (slot->hash == hash && strncmp(slot->username, username, USERNAME_KEY_SIZE - 1) == 0) {
+            return slot;
+        }
+        if (!victim || (victim->username[0] != '\0' && slot_last_used(slot) < slot_last_used(victim))) {
+            victim = slot;
+        }
+    }
+
+    victim->hash = hash;
+    strncpy(victim->username, username, USERNAME_KEY_SIZE - 1);
+    victim->username[USERNAME_KEY_SIZE - 1] = '\0';
+    for (int kind = 0; kind < RATE_KINDS; kind++) {
+        bucket_fill(&victim->buckets[kind], kind, now);
+    }
+    return victim;
+}
+
+// Alokasikan state bersama sebelum fork agar semua proses klien melihat counter yang sama
+int admission_init(void) {
+    state = mmap(NULL, sizeof(struct admission_state), PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (state == MAP_FAILED) {
+        perror("Failed to map admission state");
+        state = NULL;
+        return -1;
+    }
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&state->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return 0;
+}
+
+// Dipanggil proses utama sebelum fork; gagal jika batas koneksi atau handshake tercapai
+int admission_try_accept(void) {
+    int admitted = 0;
+
+    if (!state) return 0;
+    pthread_mutex_lock(&state->lock);
+    if (state->active < MAX_CONNECTIONS && state->handshaking < MAX_HANDSHAKES) {
+        state->active++;
+        state->handshaking++;
+        admitted = 1;
+    }
+    pthread_mutex_unlock(&state->lock);
+
+    return admitted ? 0 : -1;
+}
+
+// Koneksi yang diambil alih dari proses lama sudah lolos handshake; selalu diterima
+void admission_adopt(void) {
+    if (!state) return;
+    pthread_mutex_lock(&state->lock);
+    state->active++;
+    pthread_mutex_unlock(&state->lock);
+}
+
+void admission_handshake_done(void) {
+    if (!state) return;
+    pthread_mutex_lock(&state->lock);
+    if (state->handshaking > 0) state->handshaking--;
+    pthread_mutex_unlock(&state->lock);
+}
+
+void admission_release(void) {
+    if (!state) return;
+    pthread_mutex_lock(&state->lock);
+    if (state->active > 0) state->active--;
+    pthread_mutex_unlock(&state->lock);
+}
+
+// Tolak koneksi saat overload langsung di proses utama, tanpa fork
+void admission_reject(int client_fd) {
+    const char *response =
+        "HTTP/1.1 503 Service Unavailable\r\n"
+        "Retry-After: 1\r\n"
+        "Connection: close\r\n"
+        "Content-Length: 0\r\n\r\n";
+    send(client_fd, response, strlen(response), MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+void rate_limit_init(token_bucket buckets[RATE_KINDS]) {
+    long now = now_ms();
+    for (int kind = 0; kind < RATE_KINDS; kind++) {
+        bucket_fill(&buckets[kind], kind, now);
+    }
+}
+
+// Pesan lolos hanya jika bucket koneksi dan bucket username sama-sama masih punya token
+int rate_limit_allow(token_bucket buckets[RATE_KINDS], const char *username, enum rate_kind kind) {
+    long now = now_ms();
+
+    if (!bucket_take(&buckets[kind], kind, now)) return 0;
+    if (!state || !username || username[0] == '\0') return 1;
+
+    pthread_mutex_lock(&state->lock);
+    struct user_slot *slot = find_user_slot(username, now);
+    int allowed = bucket_take(&slot->buckets[kind], kind, now);
+    pthread_mutex_unlock(&state->lock);
+
+    return allowed;
+}
+
+// Catat satu pesan yang dibuang. Return 1 jika pelanggaran dalam RATE_VIOLATION_WINDOW_MS
+// terakhir melebihi MAX_RATE_VIOLATIONS; lonjakan sesekali pada sesi panjang tidak menumpuk.
+int rate_limit_violation(rate_violations *violations) {
+    long now = now_ms();
+    long elapsed = now - violations->last_ms;
+
+    if (elapsed > 0) {
+        violations->level -= elapsed * MAX_RATE_VIOLATIONS * 1000 / RATE_VIOLATION_WINDOW_MS;
+        if (violations->level < 0) violations->level = 0;
+    }
+    violations->last_ms = now;
+    violations->level += 1000;
+    return violations->level > MAX_RATE_VIOLATIONS * 1000L;
+}
@@ -0,0 +1,41 @@
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+#define MAX_CONNECTIONS 512         // Batas global koneksi aktif per server
+#define MAX_HANDSHAKES 32           // Batas handshake yang berjalan bersamaan
+#define HANDSHAKE_TIMEOUT_SEC 5     // Klien lambat tidak boleh menahan slot handshake
+#define USER_BUCKET_SLOTS 1024      // Jumlah slot bucket per-username (memori tetap)
+#define MAX_RATE_VIOLATIONS 20      // Pelanggaran dalam satu jendela sebelum koneksi ditutup dengan 1008
+#define RATE_VIOLATION_WINDOW_MS 10000  // Hitungan pelanggaran meluruh habis dalam jendela ini
+
+// Jenis trafik, masing-masing punya anggaran token sendiri
+enum rate_kind {
+    RATE_CHAT = 0,
+    RATE_LOCATION = 1,
+    RATE_KINDS
+};
+
+// Token bucket dalam satuan milli-token agar cukup memakai integer
+typedef struct {
+    long tokens;
+    long last_ms;
+} token_bucket;
+
+// Hitungan pelanggaran dalam milli-pelanggaran, meluruh seiring waktu seperti token bucket
+typedef struct {
+    long level;
+    long last_ms;
+} rate_violations;
+
+// Deklarasi fungsi yang ada di ratelimit.c
+int admission_init(void);
+int admission_try_accept(void);
+void admission_adopt(void);
+void admission_handshake_done(void);
+void admission_release(void);
+void admission_reject(int client_fd);
+void rate_limit_init(token_bucket buckets[RATE_KINDS]);
+int rate_limit_allow(token_bucket buckets[RATE_KINDS], const char *username, enum rate_kind kind);
+int rate_limit_violation(rate_violations *violations);
+
+#endif
@@ -0,0 +1,875 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "search_index.h"
+
+#define SEGMENT_MAGIC 0x32584943u // "CIX2"
+#define POSTING_BLOCK_SIZE 128    // Seq per blok posting list; tiap blok punya satu entri skip
+
+// Satu posting di log: term (hash) muncul di pesan nomor seq
+struct posting {
+    uint32_t hash;
+    uint32_t seq;
+};
+
+// Entri kamus term di segmen, diurutkan berdasarkan hash
+struct term_entry {
+    uint32_t hash;
+    uint32_t count;
+    uint64_t offset;
+    uint32_t length;
+    uint32_t reserved;
+};
+
+// Entri skip per blok: seq terbesar di blok dan posisi awal blok (relatif ke awal data blok)
+struct skip_entry {
+    uint32_t last_seq;
+    uint32_t offset;
+};
+
+struct segment_header {
+    uint32_t magic;
+    uint32_t nterms;
+    uint64_t table_offset;
+};
+
+struct manifest {
+    uint64_t log_offset;
+    uint32_t next_id;
+    uint32_t nsegments;
+    uint32_t ids[INDEX_MAX_SEGMENTS + 1];
+};
+
+struct segment {
+    unsigned char *base;
+    size_t size;
+    const struct term_entry *terms;
+    uint32_t nterms;
+};
+
+struct segment_writer {
+    FILE *file;
+    char path[64];
+    struct term_entry *terms;
+    size_t nterms, capacity;
+    uint64_t position;
+};
+
+// Daftar seq naik untuk satu term
+struct seq_list {
+    uint32_t *seqs;
+    size_t count, capacity;
+};
+
+// Posting list satu term di satu segmen: tabel skip, lalu blok varint berurutan
+struct block_list {
+    const struct skip_entry *skips;
+    const unsigned char *data, *end;
+    uint32_t nblocks, count;
+};
+
+// Kursor satu term query. Query berjalan dari seq besar ke kecil, jadi sumber posting dikunjungi
+// dari yang terbaru: log (source == nsegments), lalu segmen nsegments-1 sampai 0.
+struct term_cursor {
+    struct block_list blocks[INDEX_MAX_SEGMENTS + 1];
+    struct seq_list log;
+    uint64_t estimate;
+    int source;
+    int cached_source;
+    uint32_t cached_block;
+    size_t ncached;
+    uint32_t cached[POSTING_BLOCK_SIZE];
+};
+
+// ---------------------------------------------------------------------------
+// Tokenizer: huruf/angka ASCII (lowercase) dan byte UTF-8 dianggap bagian kata
+
+static int is_term_char(unsigned char c) {
+    return isalnum(c) || c >= 0x80;
+}
+
+// Ambil term berikutnya dari *text ke term; mengembalikan panjang term, 0 jika habis
+static size_t next_term(const char **text, char *term) {
+    const unsigned char *p = (const unsigned char *)*text;
+    size_t length = 0;
+
+    while (*p && !is_term_char(*p)) p++;
+    while (*p && is_term_char(*p)) {
+        if (length < INDEX_MAX_TERM_LENGTH) term[length++] = tolower(*p);
+        p++;
+    }
+    term[length] = '\0';
+    *text = (const char *)p;
+    return length;
+}
+
+static uint32_t hash_term(const char *term) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)term; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Hash term unik dari sebuah teks, terurut
+static int tokenize(const char *text, uint32_t *hashes) {
+    char term[INDEX_MAX_TERM_LENGTH + 1];
+    int count = 0;
+
+    while (count < INDEX_MAX_TERMS && next_term(&text, term) > 0) {
+        hashes[count++] = hash_term(term);
+    }
+    qsort(hashes, count, sizeof(uint32_t), compare_u32);
+
+    int unique = 0;
+    for (int i = 0; i < count; i++) {
+        if (unique == 0 || hashes[unique - 1] != hashes[i]) hashes[unique++] = hashes[i];
+    }
+    return unique;
+}
+
+// ---------------------------------------------------------------------------
+// Varint untuk selisih seq antar posting (posting list terkompresi)
+
+static size_t varint_put(unsigned char *out, uint32_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = value;
+    return n;
+}
+
+static uint32_t varint_get(const unsigned char **p, const unsigned char *end) {
+    uint32_t value = 0;
+    int shift = 0;
+    while (*p < end && shift < 35) {
+        unsigned char byte = *(*p)++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) break;
+        shift += 7;
+    }
+    return value;
+}
+
+static int seq_list_push(struct seq_list *list, uint32_t seq) {
+    if (list->count > 0 && list->seqs[list->count - 1] >= seq) return 0; // Buang duplikat
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        uint32_t *seqs = realloc(list->seqs, capacity * sizeof(uint32_t));
+        if (!seqs) return -1;
+        list->seqs = seqs;
+        list->capacity = capacity;
+    }
+    list->seqs[list->count++] = seq;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Manifest: ditulis ke file sementara lalu di-rename agar pembaca selalu melihat versi utuh
+
+static void segment_path(uint32_t id, char *path, size_t size) {
+    snprintf(path, size, "%s%u", INDEX_SEGMENT_PREFIX, id);
+}
+
+static void read_manifest(struct manifest *manifest) {
+    memset(manifest, 0, sizeof(*manifest));
+
+    int fd = open(INDEX_MANIFEST_FILE, O_RDONLY);
+    if (fd < 0) return;
+    if (read(fd, manifest, sizeof(*manifest)) != sizeof(*manifest) ||
+        manifest->nsegments > INDEX_MAX_SEGMENTS + 1) {
+        memset(manifest, 0, sizeof(*manifest));
+    }
+    close(fd);
+}
+
+static int write_manifest(const struct manifest *manifest) {
+    const char *tmp_path = INDEX_MANIFEST_FILE ".tmp";
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Failed to write index manifest");
+        return -1;
+    }
+
+    int ok = write(fd, manifest, sizeof(*manifest)) == sizeof(*manifest);
+    close(fd);
+    if (!ok || rename(tmp_path, INDEX_MANIFEST_FILE) < 0) {
+        perror("Failed to write index manifest");
+        return -1;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Segmen: header, lalu posting list terkompresi, lalu kamus term di akhir file
+
+static int segment_open(uint32_t id, struct segment *segment) {
+    char path[64];
+    struct stat st;
+
+    segment_path(id, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct segment_header)) {
+        close(fd);
+        return -1;
+    }
+
+    segment->size = st.st_size;
+    segment->base = mmap(NULL, segment->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment->base == MAP_FAILED) return -1;
+
+    const struct segment_header *header = (const struct segment_header *)segment->base;
+    if (header->magic != SEGMENT_MAGIC ||
+        header->table_offset + (uint64_t)header->nterms * sizeof(struct term_entry) > segment->size) {
+        munmap(segment->base, segment->size);
+        return -1;
+    }
+
+    segment->terms = (const struct term_entry *)(segment->base + header->table_offset);
+    segment->nterms = header->nterms;
+    return 0;
+}
+
+static void segment_close(struct segment *segment) {
+    munmap(segment->base, segment->size);
+}
+
+static const struct term_entry *segment_find(const struct segment *segment, uint32_t hash) {
+    size_t low = 0, high = segment->nterms;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (segment->terms[mid].hash < hash) low = mid + 1;
+        else high = mid;
+    }
+    if (low < segment->nterms && segment->terms[low].hash == hash) return &segment->terms[low];
+    return NULL;
+}
+
+static int block_list_open(const struct segment *segment, const struct term_entry *term, struct block_list *list) {
+    uint32_t nblocks = (term->count + POSTING_BLOCK_SIZE - 1) / POSTING_BLOCK_SIZE;
+
+    memset(list, 0, sizeof(*list));
+    if (term->offset + term->length > segment->size ||
+        (uint64_t)nblocks * sizeof(struct skip_entry) > term->length) return -1;
+
+    list->skips = (const struct skip_entry *)(segment->base + term->offset);
+    list->data = segment->base + term->offset + nblocks * sizeof(struct skip_entry);
+    list->end = segment->base + term->offset + term->length;
+    list->nblocks = nblocks;
+    list->count = term->count;
+    return 0;
+}
+
+// Decode satu blok ke seqs (naik); delta pertama relatif terhadap seq terakhir blok sebelumnya
+static size_t block_decode(const struct block_list *list, uint32_t block, uint32_t *seqs) {
+    size_t n = block + 1 < list->nblocks ? POSTING_BLOCK_SIZE : list->count - (size_t)block * POSTING_BLOCK_SIZE;
+    uint32_t seq = block > 0 ? list->skips[block - 1].last_seq : 0;
+    size_t i = 0;
+
+    if (list->skips[block].offset > (size_t)(list->end - list->data)) return 0;
+    const unsigned char *p = list->data + list->skips[block].offset;
+    for (; i < n && p < list->end; i++) {
+        seq += varint_get(&p, list->end);
+        seqs[i] = seq;
+    }
+    return i;
+}
+
+static int segment_decode(const struct segment *segment, const struct term_entry *term, struct seq_list *list) {
+    struct block_list blocks;
+    uint32_t seqs[POSTING_BLOCK_SIZE];
+
+    if (block_list_open(segment, term, &blocks) < 0) return -1;
+    for (uint32_t b = 0; b < blocks.nblocks; b++) {
+        size_t n = block_decode(&blocks, b, seqs);
+        for (size_t i = 0; i < n; i++) {
+            if (seq_list_push(list, seqs[i]) < 0) return -1;
+        }
+    }
+    return 0;
+}
+
+static int writer_open(struct segment_writer *writer, uint32_t id) {
+    struct segment_header header = { SEGMENT_MAGIC, 0, 0 };
+
+    memset(writer, 0, sizeof(*writer));
+    segment_path(id, writer->path, sizeof(writer->path));
+
+    char tmp_path[80];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", writer->path);
+    writer->file = fopen(tmp_path, "w");
+    if (!writer->file) {
+        perror("Failed to create index segment");
+        return -1;
+    }
+    fwrite(&header, sizeof(header), 1, writer->file);
+    writer->position = sizeof(header);
+    return 0;
+}
+
+// Sisipkan byte nol agar entri skip dan kamus term berikutnya sejajar
+static void writer_align(struct segment_writer *writer, size_t alignment) {
+    static const unsigned char zeros[8];
+    size_t padding = (alignment - writer->position % alignment) % alignment;
+
+    fwrite(zeros, 1, padding, writer->file);
+    writer->position += padding;
+}
+
+static int writer_add_term(struct segment_writer *writer, uint32_t hash, const uint32_t *seqs, size_t count) {
+    size_t nblocks = (count + POSTING_BLOCK_SIZE - 1) / POSTING_BLOCK_SIZE;
+    size_t table_size = nblocks * sizeof(struct skip_entry);
+    unsigned char *encoded = malloc(table_size + count * 5);
+    if (!encoded) return -1;
+
+    // Tabel skip di depan, lalu blok-blok varint; delta tetap bersambung antar blok
+    struct skip_entry *skips = (struct skip_entry *)encoded;
+    size_t length = table_size;
+    uint32_t previous = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i % POSTING_BLOCK_SIZE == 0) skips[i / POSTING_BLOCK_SIZE].offset = length - table_size;
+        length += varint_put(encoded + length, seqs[i] - previous);
+        previous = seqs[i];
+        if ((i + 1) % POSTING_BLOCK_SIZE == 0 || i + 1 == count) skips[i / POSTING_BLOCK_SIZE].last_seq = seqs[i];
+    }
+
+    if (writer->nterms == writer->capacity) {
+        size_t capacity = writer->capacity ? writer->capacity * 2 : 256;
+        struct term_entry *terms = realloc(writer->terms, capacity * sizeof(struct term_entry));
+        if (!terms) {
+            free(encoded);
+            return -1;
+        }
+        writer->terms = terms;
+        writer->capacity = capacity;
+    }
+
+    writer_align(writer, sizeof(uint32_t));
+    struct term_entry *term = &writer->terms[writer->nterms++];
+    term->hash = hash;
+    term->count = count;
+    term->offset = writer->position;
+    term->length = length;
+    term->reserved = 0;
+
+    fwrite(encoded, 1, length, writer->file);
+    writer->position += length;
+    free(encoded);
+    return 0;
+}
+
+// Tulis kamus term dan header, lalu rename agar segmen baru muncul secara atomik
+static int writer_close(struct segment_writer *writer) {
+    char tmp_path[80];
+
+    writer_align(writer, sizeof(uint64_t));
+    struct segment_header header = { SEGMENT_MAGIC, writer->nterms, writer->position };
+    fwrite(writer->terms, sizeof(struct term_entry), writer->nterms, writer->file);
+    fseek(writer->file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, writer->file);
+    int ok = fflush(writer->file) == 0 && !ferror(writer->file);
+    if (ok) fsync(fileno(writer->file));
+    fclose(writer->file);
+    free(writer->terms);
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", writer->path);
+    if (!ok || rename(tmp_path, writer->path) < 0) {
+        perror("Failed to finish index segment");
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Log posting yang belum di-merge
+
+static int compare_posting(const void *a, const void *b) {
+    const struct posting *x = a, *y = b;
+    if (x->hash != y->hash) return (x->hash > y->hash) - (x->hash < y->hash);
+    return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+// Baca posting log mulai dari offset sampai end (kelipatan ukuran posting)
+static struct posting *read_log(int fd, uint64_t offset, uint64_t end, size_t *count) {
+    size_t size = end > offset ? end - offset : 0;
+    struct posting *postings = malloc(size ? size : 1);
+
+    *count = 0;
+    if (!postings) return NULL;
+    if (size && pread(fd, postings, size, offset) != (ssize_t)size) {
+        free(postings);
+        return NULL;
+    }
+    *count = size / sizeof(struct posting);
+    return postings;
+}
+
+// ---------------------------------------------------------------------------
+// API publik
+
+// Kosongkan indeks; dipanggil bersama pengosongan chats.json
+void index_reset(void) {
+    struct manifest manifest;
+    char path[64];
+
+    read_manifest(&manifest);
+    for (uint32_t i = 0; i < manifest.nsegments; i++) {
+        segment_path(manifest.ids[i], path, sizeof(path));
+        unlink(path);
+    }
+    unlink(INDEX_MANIFEST_FILE);
+
+    int fd = open(INDEX_DOCS_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) close(fd);
+    fd = open(INDEX_LOG_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) close(fd);
+}
+
+// Catat pesan baru: offset-nya di chats.json dan (jika ada teks) posting term-nya.
+// Pemanggil harus memegang lock chats.json agar urutan seq sama dengan urutan pesan.
+long index_add_message(long offset, const char *message) {
+    struct stat st;
+    uint64_t doc_offset = offset;
+
+    int fd = open(INDEX_DOCS_FILE, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) < 0 || write(fd, &doc_offset, sizeof(doc_offset)) != sizeof(doc_offset)) {
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    long seq = st.st_size / sizeof(uint64_t);
+    if (!message) return seq;
+
+    uint32_t hashes[INDEX_MAX_TERMS];
+    struct posting postings[INDEX_MAX_TERMS];
+    int count = tokenize(message, hashes);
+    if (count == 0) return seq;
+
+    for (int i = 0; i < count; i++) {
+        postings[i].hash = hashes[i];
+        postings[i].seq = seq;
+    }
+
+    fd = open(INDEX_LOG_FILE, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return seq;
+    flock(fd, LOCK_EX);
+    if (write(fd, postings, count * sizeof(struct posting)) < 0) {
+        perror("Failed to append index log");
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    return seq;
+}
+
+long index_message_offset(long seq) {
+    uint64_t offset;
+
+    int fd = open(INDEX_DOCS_FILE, O_RDONLY);
+    if (fd < 0) return -1;
+    ssize_t n = pread(fd, &offset, sizeof(offset), seq * sizeof(uint64_t));
+    close(fd);
+
+    return n == sizeof(offset) ? (long)offset : -1;
+}
+
+// Gabungkan count segmen bersebelahan mulai dari first menjadi satu (k-way merge per term).
+// Segmen lain tidak disentuh, dan segmen baru menempati posisi first di manifest.
+static int compact_segments(struct manifest *manifest, uint32_t first, uint32_t count) {
+    struct segment segments[INDEX_MAX_SEGMENTS + 1];
+    size_t cursor[INDEX_MAX_SEGMENTS + 1] = {0};
+    struct segment_writer writer;
+    struct seq_list list = {0};
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (segment_open(manifest->ids[first + i], &segments[i]) < 0) {
+            while (i-- > 0) segment_close(&segments[i]);
+            return -1;
+        }
+    }
+
+    uint32_t id = manifest->next_id++;
+    int result = writer_open(&writer, id);
+    while (result == 0) {
+        int found = 0;
+        uint32_t hash = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (cursor[i] < segments[i].nterms && (!found || segments[i].terms[cursor[i]].hash < hash)) {
+                hash = segments[i].terms[cursor[i]].hash;
+                found = 1;
+            }
+        }
+        if (!found) break;
+
+        // Segmen tersusun menurut seq, jadi penggabungan berurutan tetap menghasilkan list naik
+        list.count = 0;
+        for (uint32_t i = 0; i < count && result == 0; i++) {
+            if (cursor[i] < segments[i].nterms && segments[i].terms[cursor[i]].hash == hash) {
+                result = segment_decode(&segments[i], &segments[i].terms[cursor[i]++], &list);
+            }
+        }
+        if (result == 0) result = writer_add_term(&writer, hash, list.seqs, list.count);
+    }
+    if (writer.file && writer_close(&writer) < 0) result = -1;
+    free(list.seqs);
+
+    for (uint32_t i = 0; i < count; i++) segment_close(&segments[i]);
+    if (result < 0) return -1;
+
+    uint32_t old_ids[INDEX_MAX_SEGMENTS + 1];
+    memcpy(old_ids, &manifest->ids[first], count * sizeof(uint32_t));
+    manifest->ids[first] = id;
+    memmove(&manifest->ids[first + 1], &manifest->ids[first + count],
+            (manifest->nsegments - first - count) * sizeof(uint32_t));
+    manifest->nsegments -= count - 1;
+    if (write_manifest(manifest) < 0) return -1;
+
+    char path[64];
+    for (uint32_t i = 0; i < count; i++) {
+        segment_path(old_ids[i], path, sizeof(path));
+        unlink(path);
+    }
+    return 0;
+}
+
+static uint64_t segment_file_size(uint32_t id) {
+    char path[64];
+    struct stat st;
+
+    segment_path(id, path, sizeof(path));
+    return stat(path, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+// Size-tiered: pilih INDEX_MERGE_WIDTH segmen bersebelahan yang ukurannya setara (total terkecil
+// lebih dulu), sehingga segmen dasar yang besar hanya ditulis ulang bersama segmen sebesar dirinya.
+// Hanya segmen bersebelahan yang boleh digabung agar rentang seq antar segmen tetap berurutan.
+// Mengembalikan posisi segmen pertama, atau -1 jika tidak ada yang perlu digabung.
+static int pick_merge_window(const struct manifest *manifest) {
+    uint64_t sizes[INDEX_MAX_SEGMENTS + 1];
+    uint64_t best_total = 0, fallback_total = 0;
+    int best = -1, fallback = -1;
+
+    for (uint32_t i = 0; i < manifest->nsegments; i++) {
+        sizes[i] = segment_file_size(manifest->ids[i]);
+        if (sizes[i] < INDEX_TIER_FLOOR) sizes[i] = INDEX_TIER_FLOOR;
+    }
+
+    for (uint32_t first = 0; first + INDEX_MERGE_WIDTH <= manifest->nsegments; first++) {
+        uint64_t smallest = sizes[first], largest = sizes[first], total = 0;
+        for (uint32_t i = first; i < first + INDEX_MERGE_WIDTH; i++) {
+            if (sizes[i] < smallest) smallest = sizes[i];
+            if (sizes[i] > largest) largest = sizes[i];
+            total += sizes[i];
+        }
+        if (fallback < 0 || total < fallback_total) {
+            fallback = first;
+            fallback_total = total;
+        }
+        if (largest <= smallest * INDEX_TIER_RATIO && (best < 0 || total < best_total)) {
+            best = first;
+            best_total = total;
+        }
+    }
+
+    // Pola beban yang aneh bisa meninggalkan segmen tak setara terus bertambah; batasi jumlahnya
+    if (best < 0 && manifest->nsegments > INDEX_MAX_SEGMENTS) best = fallback;
+    return best;
+}
+
+// Gabungkan jendela segmen sampai tidak ada lagi yang setara (satu gabungan bisa memicu tier berikutnya)
+static int compact_tiers(struct manifest *manifest) {
+    int first;
+    while ((first = pick_merge_window(manifest)) >= 0) {
+        if (compact_segments(manifest, first, INDEX_MERGE_WIDTH) < 0) return -1;
+    }
+    return 0;
+}
+
+// Satu putaran merger: log -> segmen baru, lalu kompaksi segmen yang ukurannya setara
+int index_merge(void) {
+    struct manifest manifest;
+    struct stat st;
+    size_t count;
+
+    read_manifest(&manifest);
+    if (manifest.nsegments > INDEX_MAX_SEGMENTS && compact_tiers(&manifest) < 0) return -1;
+
+    int fd = open(INDEX_LOG_FILE, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return -1;
+
+    flock(fd, LOCK_SH);
+    fstat(fd, &st);
+    if ((uint64_t)st.st_size < manifest.log_offset) manifest.log_offset = 0;
+    uint64_t end = st.st_size - st.st_size % sizeof(struct posting);
+    struct posting *postings = read_log(fd, manifest.log_offset, end, &count);
+    flock(fd, LOCK_UN);
+
+    if (!postings || count == 0) {
+        free(postings);
+        close(fd);
+        return 0;
+    }
+
+    // Bangun segmen baru di luar lock agar save_message tidak ikut menunggu
+    qsort(postings, count, sizeof(struct posting), compare_posting);
+
+    struct segment_writer writer;
+    uint32_t id = manifest.next_id++;
+    int result = writer_open(&writer, id);
+    uint32_t *seqs = malloc(count * sizeof(uint32_t));
+    if (!seqs) result = -1;
+
+    for (size_t i = 0; i < count && result == 0;) {
+        size_t n = 0;
+        uint32_t hash = postings[i].hash;
+        while (i < count && postings[i].hash == hash) {
+            if (n == 0 || seqs[n - 1] != postings[i].seq) seqs[n++] = postings[i].seq;
+            i++;
+        }
+        result = writer_add_term(&writer, hash, seqs, n);
+    }
+    if (writer.file && writer_close(&writer) < 0) result = -1;
+    free(seqs);
+    free(postings);
+
+    if (result < 0) {
+        close(fd);
+        return -1;
+    }
+
+    // Segmen baru dan pemotongan log harus terlihat bersamaan oleh pencari, jadi manifest
+    // hanya diubah di dalam LOCK_EX. Sisa posting yang datang belakangan dipindah ke awal log.
+    flock(fd, LOCK_EX);
+    manifest.ids[manifest.nsegments++] = id;
+    manifest.log_offset = end;
+    write_manifest(&manifest);
+
+    fstat(fd, &st);
+    struct posting *rest = read_log(fd, end, st.st_size - st.st_size % sizeof(struct posting), &count);
+    if (rest) {
+        ftruncate(fd, 0);
+        if (count) pwrite(fd, rest, count * sizeof(struct posting), 0);
+        manifest.log_offset = 0;
+        write_manifest(&manifest);
+        free(rest);
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    return compact_tiers(&manifest);
+}
+
+// Proses latar belakang milik server; pembangunan indeks tidak menyentuh jalur pengiriman pesan.
+// stop hanya dicek di antara merge agar log tidak pernah terpotong setengah jalan.
+void index_merge_loop(const volatile sig_atomic_t *stop) {
+    while (!*stop) {
+        index_merge();
+        if (!*stop) sleep(INDEX_MERGE_INTERVAL);
+    }
+}
+
+// Jumlah elemen naik di seqs yang <= target
+static size_t count_le(const uint32_t *seqs, size_t count, uint32_t target) {
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (seqs[mid] <= target) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+// Cari seq terbesar <= target untuk term ini. Target tidak pernah naik selama satu query, jadi
+// sumber yang sudah habis tidak dikunjungi lagi. Di segmen, tabel skip memilih satu blok saja yang
+// perlu di-decode; jika target jatuh di antara dua blok, jawabannya langsung seq terakhir blok sebelumnya.
+static int cursor_seek(struct term_cursor *cursor, int nsegments, uint32_t target, uint32_t *seq) {
+    for (; cursor->source >= 0; cursor->source--) {
+        if (cursor->source == nsegments) {
+            size_t i = count_le(cursor->log.seqs, cursor->log.count, target);
+            if (i > 0) {
+                *seq = cursor->log.seqs[i - 1];
+                return 1;
+            }
+            continue;
+        }
+
+        const struct block_list *list = &cursor->blocks[cursor->source];
+        uint32_t low = 0, high = list->nblocks;
+        while (low < high) {
+            uint32_t mid = (low + high) / 2;
+            if (list->skips[mid].last_seq < target) low = mid + 1;
+            else high = mid;
+        }
+        if (low < list->nblocks && list->skips[low].last_seq != target) {
+            if (cursor->cached_source != cursor->source || cursor->cached_block != low) {
+                cursor->ncached = block_decode(list, low, cursor->cached);
+                cursor->cached_source = cursor->source;
+                cursor->cached_block = low;
+            }
+            size_t i = count_le(cursor->cached, cursor->ncached, target);
+            if (i > 0) {
+                *seq = cursor->cached[i - 1];
+                return 1;
+            }
+        } else if (low < list->nblocks) {
+            *seq = target;
+            return 1;
+        }
+        if (low > 0) {
+            *seq = list->skips[low - 1].last_seq;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int compare_cursor(const void *a, const void *b) {
+    const struct term_cursor *x = *(struct term_cursor *const *)a, *y = *(struct term_cursor *const *)b;
+    return (x->estimate > y->estimate) - (x->estimate < y->estimate);
+}
+
+// Siapkan kursor untuk setiap term: posting list di segmen dibuka lewat mmap tanpa di-decode,
+// dan posting log yang relevan (seq < bound) dikumpulkan dalam satu kali baca.
+static int open_cursors(const uint32_t *hashes, int nterms, uint64_t bound, struct term_cursor *cursors,
+                        struct segment *segments, uint32_t *nsegments) {
+    struct manifest manifest;
+    struct stat st;
+    struct posting first;
+    size_t log_count = 0;
+    struct posting *log_postings = NULL;
+
+    // Manifest dibaca di bawah LOCK_SH log yang sama dengan yang dipakai merger saat memotong log,
+    // sehingga daftar segmen dan isi log selalu berasal dari keadaan yang sama
+    int fd = open(INDEX_LOG_FILE, O_RDONLY);
+    if (fd >= 0) flock(fd, LOCK_SH);
+
+    read_manifest(&manifest);
+    for (uint32_t i = 0; i < manifest.nsegments; i++) {
+        if (segment_open(manifest.ids[i], &segments[i]) < 0) {
+            while (i-- > 0) segment_close(&segments[i]);
+            if (fd >= 0) close(fd);
+            return -1; // Segmen baru saja dikompaksi, pemanggil mengulang
+        }
+    }
+
+    // Log berisi seq naik yang lebih baru dari semua segmen; halaman lama tidak perlu membacanya
+    if (fd >= 0) {
+        fstat(fd, &st);
+        uint64_t offset = (uint64_t)st.st_size < manifest.log_offset ? 0 : manifest.log_offset;
+        uint64_t end = st.st_size - st.st_size % sizeof(struct posting);
+        if (end > offset && pread(fd, &first, sizeof(first), offset) == sizeof(first) && first.seq < bound) {
+            log_postings = read_log(fd, offset, end, &log_count);
+        }
+        flock(fd, LOCK_UN);
+        close(fd);
+    }
+
+    for (int t = 0; t < nterms; t++) {
+        struct term_cursor *cursor = &cursors[t];
+        cursor->source = manifest.nsegments;
+        cursor->cached_source = -1;
+        for (uint32_t i = 0; i < manifest.nsegments; i++) {
+            const struct term_entry *term = segment_find(&segments[i], hashes[t]);
+            if (term && block_list_open(&segments[i], term, &cursor->blocks[i]) == 0) {
+                cursor->estimate += term->count;
+            }
+        }
+    }
+    for (size_t i = 0; i < log_count; i++) {
+        if (log_postings[i].seq >= bound) break;
+        const uint32_t *hash = bsearch(&log_postings[i].hash, hashes, nterms, sizeof(uint32_t), compare_u32);
+        if (hash) seq_list_push(&cursors[hash - hashes].log, log_postings[i].seq);
+    }
+    for (int t = 0; t < nterms; t++) cursors[t].estimate += cursors[t].log.count;
+
+    free(log_postings);
+    *nsegments = manifest.nsegments;
+    return 0;
+}
+
+// Cari pesan yang memuat semua term query; hasil berupa seq menurun (terbaru dulu) yang < before.
+// before < 0 berarti mulai dari pesan terbaru. Hasil bisa memuat tabrakan hash, cek dengan index_matches().
+int index_search(const char *query, long before, int limit, long *results) {
+    uint32_t hashes[INDEX_MAX_TERMS];
+    struct term_cursor *order[INDEX_MAX_TERMS];
+    struct segment segments[INDEX_MAX_SEGMENTS + 1];
+    uint32_t nsegments = 0;
+    int found = 0;
+
+    int nterms = tokenize(query, hashes);
+    if (nterms == 0 || limit <= 0 || before == 0) return 0;
+
+    uint64_t bound = before < 0 ? UINT64_MAX : (uint64_t)before;
+    struct term_cursor *cursors = calloc(nterms, sizeof(struct term_cursor));
+    if (!cursors) return 0;
+    if (open_cursors(hashes, nterms, bound, cursors, segments, &nsegments) < 0) {
+        memset(cursors, 0, nterms * sizeof(struct term_cursor));
+        if (open_cursors(hashes, nterms, bound, cursors, segments, &nsegments) < 0) {
+            free(cursors);
+            return 0;
+        }
+    }
+
+    // Leapfrog dari seq terbesar ke bawah, dimulai dari term paling jarang. Setiap term melompat ke
+    // seq terbesar <= kandidat; kandidat menjadi hasil setelah semua term setuju, dan berhenti di limit.
+    for (int t = 0; t < nterms; t++) order[t] = &cursors[t];
+    qsort(order, nterms, sizeof(order[0]), compare_cursor);
+
+    uint32_t candidate = bound > UINT32_MAX ? UINT32_MAX : (uint32_t)(bound - 1);
+    int agreed = 0;
+    for (int t = 0; found < limit; t = (t + 1) % nterms) {
+        uint32_t seq;
+        if (!cursor_seek(order[t], nsegments, candidate, &seq)) break;
+        if (seq == candidate) {
+            agreed++;
+        } else {
+            candidate = seq;
+            agreed = 1;
+        }
+        if (agreed == nterms) {
+            results[found++] = candidate;
+            if (candidate == 0) break;
+            candidate--;
+            agreed = 0;
+        }
+    }
+
+    for (int t = 0; t < nterms; t++) free(cursors[t].log.seqs);
+    free(cursors);
+    for (uint32_t i = 0; i < nsegments; i++) segment_close(&segments[i]);
+    return found;
+}
+
+// Verifikasi teks: setiap term query harus muncul sebagai kata utuh di teks
+int index_matches(const char *text, const char *query) {
+    char query_term[INDEX_MAX_TERM_LENGTH + 1], text_term[INDEX_MAX_TERM_LENGTH + 1];
+
+    while (next_term(&query, query_term) > 0) {
+        const char *p = text;
+        int found = 0;
+        while (!found && next_term(&p, text_term) > 0) {
+            found = strcmp(query_term, text_term) == 0;
+        }
+        if (!found) return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,28 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <stdint.h>
+#include <signal.h>
+
+#define INDEX_DOCS_FILE "data/chats.idx.docs"          // Offset tiap pesan di chats.json, indeks = seq
+#define INDEX_LOG_FILE "data/chats.idx.log"            // Posting baru (term, seq) yang belum di-merge
+#define INDEX_MANIFEST_FILE "data/chats.idx.manifest"  // Daftar segmen aktif + posisi log yang sudah di-merge
+#define INDEX_SEGMENT_PREFIX "data/chats.idx.seg."
+#define INDEX_MERGE_INTERVAL 1   // Detik antar putaran merger
+#define INDEX_MAX_SEGMENTS 32    // Batas keras jumlah segmen; di atas ini segmen tetap digabung walau ukurannya tidak setara
+#define INDEX_MERGE_WIDTH 4      // Jumlah segmen bersebelahan yang digabung dalam satu kompaksi
+#define INDEX_TIER_RATIO 4       // Segmen dianggap setara jika yang terbesar <= rasio ini x yang terkecil
+#define INDEX_TIER_FLOOR (1024 * 1024)  // Segmen di bawah ukuran ini dihitung sebesar ini
+#define INDEX_MAX_TERMS 64       // Term per query/pesan yang diperhitungkan
+#define INDEX_MAX_TERM_LENGTH 64
+
+// Deklarasi fungsi yang ada di search_index.c
+void index_reset(void);
+long index_add_message(long offset, const char *message);
+long index_message_offset(long seq);
+int index_merge(void);
+void index_merge_loop(const volatile sig_atomic_t *stop);
+int index_search(const char *query, long before, int limit, long *results);
+int index_matches(const char *text, const char *query);
+
+#endif
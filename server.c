@@ -0,0 +1,810 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include "websocket.h"
+#include "search_index.h"
+#include "upgrade.h"
+#include "server.h"
+
+// Penanda di notify_fd: pengirim meminta state pembaca, pembaca membalas dengan state-nya
+#define NOTIFY_HANDOFF_REQUEST 'U'
+#define NOTIFY_HANDOFF 0xFF
+
+// Tag channel hanya dikirim jika chat dan lokasi berjalan di koneksi yang sama
+static int multiplexed = 0;
+static int server_port = PORT;
+
+// Diset proses utama lama saat upgrade; dibaca semua proses koneksi lewat memori bersama
+static volatile int *upgrade_flag = NULL;
+static volatile sig_atomic_t upgrade_requested = 0;
+static volatile sig_atomic_t background_stop = 0;  // Hanya dipakai di proses latar belakang
+static pid_t background_pids[2] = { -1, -1 };
+static pid_t master_pid = -1;
+static char pid_path[64];
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+static int notify_send(int notify_fd, unsigned char tag, const char *data, size_t length) {
+    struct iovec parts[2] = { { &tag, 1 }, { (void *)data, length } };
+    struct msghdr msg = { .msg_iov = parts, .msg_iovlen = 2 };
+    return sendmsg(notify_fd, &msg, MSG_NOSIGNAL) < 0 ? -1 : 0;
+}
+
+// Kirim satu frame WebSocket lewat penjadwal keluar.
+// Proses pengirim langsung mengantrikan frame; proses pembaca meneruskannya lewat notify_fd
+// (satu byte kelas diikuti frame) agar semua frame ke klien melewati antrian yang sama.
+// Sebelum proses dipecah (saat handshake) frame dikirim langsung.
+int server_send_frame(struct connection *conn, enum outq_class cls, const char *key, const char *frame, size_t length) {
+    if (conn->outq) return outq_push(conn->outq, cls, key, frame, length);
+    if (conn->notify_fd >= 0) return notify_send(conn->notify_fd, cls, frame, length);
+    return send(conn->client_fd, frame, length, MSG_NOSIGNAL) < 0 ? -1 : 0;
+}
+
+// Kirim objek JSON sebagai frame teks; dalam mode gabungan objek diberi tag channel.
+// key (username) menandai update lokasi yang boleh digabung atau dibuang penjadwal.
+int server_send_json(struct connection *conn, const char *channel, const char *key, cJSON *object) {
+    if (multiplexed) cJSON_AddStringToObject(object, "channel", channel);
+    char *json_string = cJSON_PrintUnformatted(object);
+    if (multiplexed) cJSON_DeleteItemFromObject(object, "channel");
+    if (!json_string) return -1;
+
+    int result = -1;
+    char *frame = malloc(strlen(json_string) + 10);
+    if (frame) {
+        int frame_len = websocket_encode(json_string, frame);
+        enum outq_class cls = strcmp(channel, CHANNEL_LOCATION) == 0 ? OUTQ_LOCATION : OUTQ_CHAT;
+        result = server_send_frame(conn, cls, key, frame, frame_len);
+        free(frame);
+    }
+    free(json_string);
+    return result;
+}
+
+static void drop_location(void *context, const char *username) {
+    location_forget(context, username);
+}
+
+// Terima frame dari proses pembaca. Return 0 jika proses pembaca sudah selesai.
+// Balasan atas permintaan upgrade (state pembaca) dikembalikan lewat reader_state.
+static int receive_notify(struct connection *conn, int notify_fd, cJSON **reader_state) {
+    ssize_t length = recv(notify_fd, NULL, 0, MSG_PEEK | MSG_TRUNC);
+    if (length <= 0) return length < 0 && errno == EINTR ? 1 : 0;
+
+    unsigned char *message = malloc(length + 1);
+    if (!message) return 0;
+    length = recv(notify_fd, message, length, 0);
+    if (length > 0) message[length] = '\0';
+
+    if (length > 1 && message[0] == NOTIFY_HANDOFF) {
+        *reader_state = cJSON_Parse((const char *)message + 1);
+    } else if (length > 1 && message[0] < OUTQ_CLASSES) {
+        outq_push(conn->outq, message[0], NULL, (const char *)message + 1, length - 1);
+    }
+    free(message);
+    return length > 0;
+}
+
+// Kirim sisa antrian (misalnya frame close) dengan batas waktu sebelum proses pengirim keluar
+static void drain_queue(struct outq *queue, int client_fd) {
+    long deadline = now_ms() + DRAIN_TIMEOUT_MS;
+    while (outq_pending(queue) && outq_write(queue, client_fd) == 0) {
+        long remaining = deadline - now_ms();
+        if (remaining <= 0) break;
+        struct pollfd out = { client_fd, POLLOUT, 0 };
+        if (poll(&out, 1, remaining) <= 0) break;
+    }
+}
+
+static void export_frame(void *context, enum outq_class cls, const char *key, const char *data, size_t length) {
+    cJSON *frame = cJSON_CreateObject();
+    char *hex = upgrade_hex_encode(data, length);
+    cJSON_AddNumberToObject(frame, "class", cls);
+    cJSON_AddStringToObject(frame, "key", key);
+    cJSON_AddStringToObject(frame, "data", hex ? hex : "");
+    cJSON_AddItemToArray(context, frame);
+    free(hex);
+}
+
+// Serahkan soket klien beserta state-nya ke proses baru. Antrian keluar ikut dipindah
+// sehingga frame yang belum terkirim tidak hilang.
+static int hand_off_connection(struct connection *conn, struct outq *queue, cJSON *reader_state) {
+    cJSON *state = cJSON_CreateObject();
+    const char *unsent = NULL;
+    size_t unsent_length = outq_unsent(queue, &unsent);
+    char *current = upgrade_hex_encode(unsent, unsent_length);
+
+    cJSON_AddStringToObject(state, "username", conn->username);
+    cJSON_AddNumberToObject(state, "chat_last_index", conn->chat_last_index);
+    cJSON_AddStringToObject(state, "chat_join_time", conn->chat_join_time);
+    cJSON_AddItemToObject(state, "reader", cJSON_Duplicate(cJSON_GetObjectItem(reader_state, "reader"), 1));
+    cJSON_AddItemToObject(state, "violations", cJSON_Duplicate(cJSON_GetObjectItem(reader_state, "violations"), 1));
+    cJSON_AddItemToObject(state, "violations_ms", cJSON_Duplicate(cJSON_GetObjectItem(reader_state, "violations_ms"), 1));
+    cJSON_AddStringToObject(state, "current", current ? current : "");
+    outq_visit(queue, export_frame, cJSON_AddArrayToObject(state, "pending"));
+    free(current);
+
+    char *payload = cJSON_PrintUnformatted(state);
+    cJSON_Delete(state);
+    if (!payload) return -1;
+
+    int result = -1;
+    int sock = upgrade_connect(server_port);
+    if (sock >= 0) {
+        result = upgrade_send(sock, UPGRADE_CONNECTION, conn->client_fd, payload, strlen(payload));
+        close(sock);
+    }
+    free(payload);
+    return result;
+}
+
+// Isi antrian proses baru dengan frame yang belum terkirim di proses lama
+static void restore_queue(struct outq *queue, cJSON *resume) {
+    char *buffer;
+    const char *current = cJSON_GetStringValue(cJSON_GetObjectItem(resume, "current"));
+    if (current && current[0] && (buffer = malloc(strlen(current) / 2 + 1))) {
+        long length = upgrade_hex_decode(current, buffer, strlen(current) / 2);
+        if (length > 0) outq_resume(queue, buffer, length);
+        free(buffer);
+    }
+
+    cJSON *frame;
+    cJSON_ArrayForEach(frame, cJSON_GetObjectItem(resume, "pending")) {
+        const char *data = cJSON_GetStringValue(cJSON_GetObjectItem(frame, "data"));
+        const char *key = cJSON_GetStringValue(cJSON_GetObjectItem(frame, "key"));
+        int cls = (int)cJSON_GetNumberValue(cJSON_GetObjectItem(frame, "class"));
+        if (!data || cls < 0 || cls >= OUTQ_CLASSES || !(buffer = malloc(strlen(data) / 2 + 1))) continue;
+
+        long length = upgrade_hex_decode(data, buffer, strlen(data) / 2);
+        if (length > 0) outq_push(queue, cls, key, buffer, length);
+        free(buffer);
+    }
+}
+
+// Proses pengirim: baca file data tiap POLL_INTERVAL_MS, kirim isi antrian saat soket siap.
+// Saat upgrade, minta state pembaca lalu serahkan koneksi ke proses baru.
+static void run_sender(struct connection *conn, int notify_fd, cJSON *resume) {
+    struct outq queue;
+    outq_init(&queue, drop_location, conn);
+    conn->outq = &queue;
+    conn->notify_fd = -1;
+    if (resume) restore_queue(&queue, resume);
+
+    int handoff_requested = 0;
+    long handoff_deadline = 0;
+    long next_poll = now_ms();
+    while (1) {
+        if (upgrade_flag && *upgrade_flag && !handoff_requested) {
+            char request = NOTIFY_HANDOFF_REQUEST;
+            send(notify_fd, &request, 1, MSG_NOSIGNAL);
+            handoff_requested = 1;
+            handoff_deadline = now_ms() + UPGRADE_HANDOFF_SEC * 1000L;
+        }
+
+        long now = now_ms();
+        if (handoff_requested && now >= handoff_deadline) {
+            // Pembaca tidak menjawab: jangan biarkan koneksi menggantung tanpa pengiriman.
+            // shutdown membangunkan pembaca, yang lalu melepas username dan slotnya sendiri.
+            char frame[BUFFER_SIZE];
+            int frame_len = websocket_encode_close(WS_CLOSE_GOING_AWAY, "Server restarting", frame);
+            outq_push(&queue, OUTQ_CONTROL, NULL, frame, frame_len);
+            drain_queue(&queue, conn->client_fd);
+            shutdown(conn->client_fd, SHUT_RDWR);
+            break;
+        }
+        if (now >= next_poll) {
+            // Jika klien lambat, pesan chat ditahan di chats.json, bukan di memori.
+            // Selama upgrade chat_last_index dibekukan agar ikut pindah apa adanya.
+            if (!handoff_requested) {
+                if ((conn->services & SERVICE_CHAT) && outq_length(&queue, OUTQ_CHAT) < OUTQ_CHAT_HIGH_WATER) {
+                    chat_poll(conn);
+                }
+                if (conn->services & SERVICE_LOCATION) location_poll(conn);
+            }
+            next_poll = now + POLL_INTERVAL_MS;
+        }
+
+        if (outq_write(&queue, conn->client_fd) < 0) {
+            // Bangunkan proses pembaca yang masih menunggu recv
+            shutdown(conn->client_fd, SHUT_RDWR);
+            break;
+        }
+
+        struct pollfd fds[2] = {
+            { notify_fd, POLLIN, 0 },
+            { conn->client_fd, outq_pending(&queue) ? POLLOUT : 0, 0 },
+        };
+        long wake = handoff_requested && handoff_deadline < next_poll ? handoff_deadline : next_poll;
+        long wait = wake - now_ms();
+        if (poll(fds, 2, wait > 0 ? wait : 0) < 0 && errno != EINTR) break;
+        if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+        cJSON *reader_state = NULL;
+        int reader_alive = receive_notify(conn, notify_fd, &reader_state);
+        if (reader_state) {
+            int handed_off = hand_off_connection(conn, &queue, reader_state) == 0;
+            cJSON_Delete(reader_state);
+            if (handed_off) break;
+
+            // Proses baru tidak bisa dihubungi dan pembaca sudah berhenti: minta klien tersambung ulang
+            char frame[BUFFER_SIZE];
+            int frame_len = websocket_encode_close(WS_CLOSE_GOING_AWAY, "Server restarting", frame);
+            outq_push(&queue, OUTQ_CONTROL, NULL, frame, frame_len);
+            drain_queue(&queue, conn->client_fd);
+            if (conn->services & SERVICE_CHAT) chat_disconnect(conn);
+            admission_release();
+            break;
+        }
+        if (!reader_alive) {
+            // Pembaca selesai: kirim sisa antrian (misalnya frame close) sebelum keluar
+            drain_queue(&queue, conn->client_fd);
+            break;
+        }
+    }
+
+    outq_free(&queue);
+    conn->outq = NULL;
+}
+
+// Pesan tanpa channel (klien lama) diarahkan ke satu-satunya layanan, atau ke chat
+static int channel_service(const char *channel, int services) {
+    if (channel && strcmp(channel, CHANNEL_LOCATION) == 0) return services & SERVICE_LOCATION;
+    if (channel && strcmp(channel, CHANNEL_CHAT) == 0) return services & SERVICE_CHAT;
+    return (services & SERVICE_CHAT) ? SERVICE_CHAT : SERVICE_LOCATION;
+}
+
+// Kirim state pembaca (isi buffer parser) ke proses pengirim yang sedang menyiapkan upgrade
+static void send_reader_state(struct connection *conn) {
+    cJSON *state = cJSON_CreateObject();
+    char *reader = upgrade_hex_encode(conn->reader.data, conn->reader.length);
+    cJSON_AddStringToObject(state, "reader", reader ? reader : "");
+    cJSON_AddNumberToObject(state, "violations", conn->violations.level);
+    cJSON_AddNumberToObject(state, "violations_ms", conn->violations.last_ms);
+    free(reader);
+
+    char *payload = cJSON_PrintUnformatted(state);
+    cJSON_Delete(state);
+    if (payload) notify_send(conn->notify_fd, NOTIFY_HANDOFF, payload, strlen(payload));
+    free(payload);
+}
+
+// Layani koneksi yang sudah terdaftar dengan sepasang proses pembaca dan pengirim.
+// resume berisi state dari proses lama jika koneksi ini hasil upgrade.
+static void serve_connection(struct connection *conn, cJSON *resume) {
+    char buffer[BUFFER_SIZE], message[BUFFER_SIZE];
+    int client_fd = conn->client_fd;
+    int services = conn->services;
+    int opcode;
+
+    // Proses pembaca meneruskan frame keluar ke proses pengirim lewat socketpair
+    int notify[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, notify) < 0) {
+        if (services & SERVICE_CHAT) chat_disconnect(conn);
+        admission_release();
+        close(client_fd);
+        return;
+    }
+
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        close(notify[0]);
+        conn->notify_fd = notify[1];
+        rate_limit_init(conn->buckets);
+
+        // Handle client messages
+        while (1) {
+            // Tunggu data klien atau permintaan upgrade dari proses pengirim
+            if (!websocket_frame_ready(&conn->reader)) {
+                struct pollfd fds[2] = { { client_fd, POLLIN, 0 }, { conn->notify_fd, POLLIN, 0 } };
+                if (poll(fds, 2, -1) < 0) continue;
+                if (fds[1].revents) {
+                    if (recv(conn->notify_fd, buffer, 1, 0) == 1) {
+                        // Koneksi berlanjut di proses baru: username dan slot tidak dilepas
+                        send_reader_state(conn);
+                        close(conn->notify_fd);
+                        close(client_fd);
+                        exit(0);
+                    }
+                    break;
+                }
+            }
+
+            int bytes_received = websocket_read_frame(client_fd, &conn->reader, &opcode, message, BUFFER_SIZE);
+            if (bytes_received == WS_READ_AGAIN) continue;
+            if (bytes_received < 0) break;
+
+            if (opcode == WS_OPCODE_CLOSE) {
+                int frame_len = websocket_encode_close(WS_CLOSE_NORMAL, NULL, buffer);
+                server_send_frame(conn, OUTQ_CONTROL, NULL, buffer, frame_len);
+                break;
+            }
+            if (opcode == WS_OPCODE_PING) {
+                int frame_len = websocket_encode_control(WS_OPCODE_PONG, message, bytes_received, buffer);
+                server_send_frame(conn, OUTQ_CONTROL, NULL, buffer, frame_len);
+                continue;
+            }
+            if (opcode != WS_OPCODE_TEXT) continue;
+
+            cJSON *json = cJSON_Parse(message);
+            if (!json) continue;
+
+            const char *channel = cJSON_GetStringValue(cJSON_GetObjectItem(json, "channel"));
+            int service = channel_service(channel, services);
+            if (!service) {
+                cJSON_Delete(json);
+                continue;
+            }
+
+            // Pesan di luar anggaran dibuang; klien yang terus membanjiri ditutup dengan 1008
+            enum rate_kind kind = service == SERVICE_CHAT ? RATE_CHAT : RATE_LOCATION;
+            if (!rate_limit_allow(conn->buckets, conn->username, kind)) {
+                cJSON_Delete(json);
+                if (rate_limit_violation(&conn->violations)) {
+                    int frame_len = websocket_encode_close(WS_CLOSE_POLICY_VIOLATION, "Rate limit exceeded", buffer);
+                    server_send_frame(conn, OUTQ_CONTROL, NULL, buffer, frame_len);
+                    break;
+                }
+                continue;
+            }
+
+            if (service == SERVICE_CHAT) {
+                chat_handle_message(conn, json);
+            } else {
+                location_handle_message(conn, json);
+            }
+
+            cJSON_Delete(json);
+        }
+
+        // Koneksi selesai: lepaskan identitas dan slot. Menutup notify_fd memberi tahu
+        // proses pengirim untuk mengirim sisa antrian lalu berhenti.
+        if (services & SERVICE_CHAT) chat_disconnect(conn);
+        admission_release();
+        close(conn->notify_fd);
+        close(client_fd);
+        exit(0);
+    } else if (pid > 0) {
+        close(notify[1]);
+        run_sender(conn, notify[0], resume);
+        close(notify[0]);
+        close(client_fd);
+        return;
+    }
+
+    close(notify[0]);
+    close(notify[1]);
+    if (services & SERVICE_CHAT) chat_disconnect(conn);
+    admission_release();
+    close(client_fd);
+}
+
+// Handle client connection
+void handle_client(int client_fd, int services) {
+    char buffer[BUFFER_SIZE], message[BUFFER_SIZE];
+    struct connection conn;
+    int opcode;
+
+    memset(&conn, 0, sizeof(conn));
+    conn.client_fd = client_fd;
+    conn.services = services;
+    conn.notify_fd = -1;
+
+    // Batasi waktu handshake agar klien lambat tidak menahan slot handshake. Batas ini berlaku
+    // untuk seluruh handshake sampai pesan connect utuh, bukan per recv.
+    long handshake_deadline = now_ms() + HANDSHAKE_TIMEOUT_SEC * 1000L;
+    struct timeval timeout = { HANDSHAKE_TIMEOUT_SEC, 0 };
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // Lakukan WebSocket handshake
+    int bytes_received = recv(client_fd, buffer, BUFFER_SIZE - 1, 0);
+    if (bytes_received > 0) buffer[bytes_received] = '\0';
+    if (bytes_received <= 0 || handle_handshake(client_fd, buffer) < 0) {
+        admission_handshake_done();
+        admission_release();
+        close(client_fd);
+        return;
+    }
+
+    // Terima pesan koneksi awal dari klien; byte yang menetes pelan tidak memperpanjang batas waktu
+    do {
+        long remaining = handshake_deadline - now_ms();
+        struct pollfd incoming = { client_fd, POLLIN, 0 };
+        if (!websocket_frame_ready(&conn.reader) && (remaining <= 0 || poll(&incoming, 1, remaining) <= 0)) {
+            bytes_received = -1;
+            break;
+        }
+        bytes_received = websocket_read_frame(client_fd, &conn.reader, &opcode, message, BUFFER_SIZE);
+    } while (bytes_received == WS_READ_AGAIN);
+    admission_handshake_done();
+    if (bytes_received < 0 || opcode != WS_OPCODE_TEXT) {
+        admission_release();
+        close(client_fd);
+        return;
+    }
+
+    // Parse JSON untuk mendapatkan username. Identitas hanya diambil dari pesan connect;
+    // frame lain tidak boleh memakai username orang lain tanpa pemeriksaan di chat_connect.
+    cJSON *json = cJSON_Parse(message);
+    const char *type = cJSON_GetStringValue(cJSON_GetObjectItem(json, "type"));
+    const char *received_username = cJSON_GetStringValue(cJSON_GetObjectItem(json, "username"));
+    if (!type || strcmp(type, "connect") != 0 || !received_username || !received_username[0]) {
+        cJSON_Delete(json);
+        admission_release();
+        close(client_fd);
+        return;
+    }
+    strncpy(conn.username, received_username, BUFFER_SIZE - 1);
+
+    // Satu identitas untuk semua layanan: koneksi ditolak jika salah satu layanan menolak
+    if (((services & SERVICE_CHAT) && chat_connect(&conn, json) < 0) ||
+        ((services & SERVICE_LOCATION) && location_connect(&conn, json) < 0)) {
+        cJSON_Delete(json);
+        admission_release();
+        close(client_fd);
+        return;
+    }
+    cJSON_Delete(json);
+
+    printf("New client connected: %s\n", conn.username);
+
+    // Handshake selesai, koneksi boleh menunggu pesan tanpa batas waktu
+    timeout.tv_sec = 0;
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    serve_connection(&conn, NULL);
+}
+
+// Lanjutkan koneksi yang diserahkan proses lama: tanpa handshake dan tanpa pesan connect
+static void resume_client(int upgrade_sock, int services) {
+    char type, *payload;
+    int client_fd;
+
+    if (upgrade_recv(upgrade_sock, &type, &client_fd, &payload) < 0) {
+        close(upgrade_sock);
+        return;
+    }
+    close(upgrade_sock);
+
+    cJSON *state = cJSON_Parse(payload);
+    free(payload);
+    const char *username = cJSON_GetStringValue(cJSON_GetObjectItem(state, "username"));
+    if (type != UPGRADE_CONNECTION || !username) {
+        cJSON_Delete(state);
+        close(client_fd);
+        return;
+    }
+
+    struct connection conn;
+    memset(&conn, 0, sizeof(conn));
+    conn.client_fd = client_fd;
+    conn.services = services;
+    conn.notify_fd = -1;
+    strncpy(conn.username, username, BUFFER_SIZE - 1);
+    conn.chat_last_index = (long)cJSON_GetNumberValue(cJSON_GetObjectItem(state, "chat_last_index"));
+    conn.violations.level = (long)cJSON_GetNumberValue(cJSON_GetObjectItem(state, "violations"));
+    conn.violations.last_ms = (long)cJSON_GetNumberValue(cJSON_GetObjectItem(state, "violations_ms"));
+
+    const char *join_time = cJSON_GetStringValue(cJSON_GetObjectItem(state, "chat_join_time"));
+    if (join_time) strncpy(conn.chat_join_time, join_time, sizeof(conn.chat_join_time) - 1);
+
+    // Byte frame yang sudah dibaca proses lama tetapi belum utuh
+    const char *reader = cJSON_GetStringValue(cJSON_GetObjectItem(state, "reader"));
+    long reader_length = reader ? upgrade_hex_decode(reader, conn.reader.data, sizeof(conn.reader.data)) : 0;
+    conn.reader.length = reader_length > 0 ? reader_length : 0;
+
+    // Username sudah ada di users.json; state tidak berisi lat/lon sehingga
+    // location_connect hanya menyiapkan penulis riwayat
+    if (services & SERVICE_LOCATION) location_connect(&conn, state);
+    admission_adopt();
+
+    printf("Client resumed: %s\n", conn.username);
+    serve_connection(&conn, state);
+    cJSON_Delete(state);
+}
+
+static void request_upgrade(int signum) {
+    (void)signum;
+    upgrade_requested = 1;
+}
+
+// SIGINT/SIGTERM di proses utama: hapus pid file, hentikan proses latar belakang, lalu mati
+// seperti biasa. Proses koneksi mewarisi handler ini tetapi langsung memakai perilaku default.
+static void request_shutdown(int signum) {
+    if (getpid() == master_pid) {
+        unlink(pid_path);
+        for (int i = 0; i < 2; i++) {
+            if (background_pids[i] > 0) kill(background_pids[i], SIGTERM);
+        }
+    }
+    signal(signum, SIG_DFL);
+    raise(signum);
+}
+
+static void request_background_stop(int signum) {
+    (void)signum;
+    background_stop = 1;
+}
+
+// SIGTERM hanya menyalakan flag; tanpa SA_RESTART agar sleep() di loop langsung terputus.
+// Soket listen dan upgrade ditutup: jika proses utama mati tanpa SIGTERM, proses ini tidak boleh
+// ikut menahan port yang kemudian di-bind ulang dengan SO_REUSEPORT.
+static void run_background(void (*loop)(const volatile sig_atomic_t *stop), int server_fd, int upgrade_fd) {
+    if (server_fd >= 0) close(server_fd);
+    if (upgrade_fd >= 0) close(upgrade_fd);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = request_background_stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+    signal(SIGUSR2, SIG_IGN);
+
+    loop(&background_stop);
+    exit(0);
+}
+
+// Pekerjaan latar belakang tiap layanan berjalan di proses sendiri, di luar jalur pengiriman
+static void start_background(int services, int server_fd, int upgrade_fd) {
+    if ((services & SERVICE_CHAT) && (background_pids[0] = fork()) == 0) {
+        run_background(index_merge_loop, server_fd, upgrade_fd);
+    }
+    if ((services & SERVICE_LOCATION) && (background_pids[1] = fork()) == 0) {
+        run_background(track_compact_loop, server_fd, upgrade_fd);
+    }
+}
+
+// Tunggu merge/kompaksi yang sedang berjalan selesai sebelum proses baru memulai miliknya.
+// SIGCHLD diabaikan sehingga anak tidak bisa di-waitpid; cukup tunggu pid-nya hilang.
+static void stop_background(void) {
+    for (int i = 0; i < 2; i++) {
+        if (background_pids[i] > 0) kill(background_pids[i], SIGTERM);
+    }
+    long deadline = now_ms() + UPGRADE_WAIT_SEC * 1000L;
+    for (int i = 0; i < 2; i++) {
+        while (background_pids[i] > 0 && kill(background_pids[i], 0) == 0 && now_ms() < deadline) {
+            usleep(10000);
+        }
+        background_pids[i] = -1;
+    }
+}
+
+// Proses lama: serahkan soket listen ke proses baru, minta semua koneksi pindah, lalu keluar
+static void hand_off_listener(int server_fd, int upgrade_fd, int services) {
+    upgrade_requested = 0;
+
+    int sock = upgrade_connect(server_port);
+    if (sock < 0) {
+        perror("Upgrade: failed to reach new process");
+        return;
+    }
+
+    // Hentikan pekerjaan latar belakang lebih dulu agar tidak berjalan ganda dengan milik proses baru
+    stop_background();
+    if (upgrade_send(sock, UPGRADE_LISTENER, server_fd, NULL, 0) < 0) {
+        perror("Upgrade: failed to send listening socket");
+        close(sock);
+        start_background(services, server_fd, upgrade_fd);
+        return;
+    }
+    close(sock);
+
+    if (upgrade_flag) *upgrade_flag = 1;
+    printf("Listening socket handed over, connections are moving to the new process\n");
+    close(server_fd);
+    exit(0);
+}
+
+// Proses baru: minta soket listen dari proses lama yang masih memegang lock pid file
+static int take_over_listener(int *upgrade_fd) {
+    int sock = upgrade_listen(server_port);
+    if (sock < 0) {
+        perror("Upgrade: failed to create upgrade socket");
+        return -1;
+    }
+
+    pid_t old_pid = upgrade_read_pid(server_port);
+    if (old_pid <= 0 || kill(old_pid, SIGUSR2) < 0) {
+        fprintf(stderr, "Upgrade: no running server found for port %d\n", server_port);
+        close(sock);
+        return -1;
+    }
+
+    struct pollfd incoming = { sock, POLLIN, 0 };
+    int peer = poll(&incoming, 1, UPGRADE_WAIT_SEC * 1000) > 0 ? accept(sock, NULL, NULL) : -1;
+    char type, *payload;
+    int server_fd;
+    if (peer < 0 || upgrade_recv(peer, &type, &server_fd, &payload) < 0) {
+        fprintf(stderr, "Upgrade: old process did not hand over its listening socket\n");
+        if (peer >= 0) close(peer);
+        close(sock);
+        return -1;
+    }
+    free(payload);
+    close(peer);
+
+    if (type != UPGRADE_LISTENER) {
+        close(server_fd);
+        close(sock);
+        return -1;
+    }
+
+    *upgrade_fd = sock;
+    return server_fd;
+}
+
+static void adopt_connection(int server_fd, int upgrade_fd, int services) {
+    int sock = accept(upgrade_fd, NULL, NULL);
+    if (sock < 0) return;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        signal(SIGUSR2, SIG_IGN);
+        close(server_fd);
+        close(upgrade_fd);
+        resume_client(sock, services);
+        exit(0);
+    }
+    close(sock);
+}
+
+static int open_listener(int port) {
+    struct sockaddr_in address;
+    int opt = 1;
+
+    int server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt));
+
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+
+    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        perror("Failed to bind server socket");
+        close(server_fd);
+        return -1;
+    }
+    listen(server_fd, SOMAXCONN);
+    return server_fd;
+}
+
+int server_run(int port, int services, int upgrading) {
+    int server_fd, new_socket;
+    int upgrade_fd = -1;
+    long upgrade_until = 0;
+    struct sockaddr_in address;
+    socklen_t addrlen = sizeof(address);
+
+    multiplexed = services == (SERVICE_CHAT | SERVICE_LOCATION);
+    server_port = port;
+
+    // Saat upgrade data lama tetap dipakai: klien yang pindah masih memegang username dan posisi chat-nya
+    if (!upgrading) {
+        if (services & SERVICE_CHAT) chat_initialize();
+        if (services & SERVICE_LOCATION) location_initialize();
+    }
+    admission_init();
+
+    upgrade_flag = mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (upgrade_flag == MAP_FAILED) upgrade_flag = NULL;
+
+    // Signal handler to reap zombie processes
+    signal(SIGCHLD, SIG_IGN);
+
+    // SIGUSR2 dari proses baru memulai upgrade; tanpa SA_RESTART agar accept() terputus
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = request_upgrade;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR2, &action, NULL);
+
+    master_pid = getpid();
+    snprintf(pid_path, sizeof(pid_path), UPGRADE_PID_FILE, port);
+    action.sa_handler = request_shutdown;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    if (upgrading) {
+        server_fd = take_over_listener(&upgrade_fd);
+        upgrade_until = now_ms() + UPGRADE_WINDOW_SEC * 1000L;
+    } else {
+        server_fd = open_listener(port);
+    }
+    if (server_fd < 0) return 1;
+
+    start_background(services, server_fd, upgrade_fd);
+    // Proses lama keluar tepat setelah menyerahkan soket listen, lalu lock-nya lepas
+    if (upgrade_write_pid(port, upgrading ? UPGRADE_WAIT_SEC : 0) < 0) perror("Failed to lock pid file");
+
+    printf("Server is running on port %d (%s%s%s)\n", port,
+           (services & SERVICE_CHAT) ? CHANNEL_CHAT : "",
+           multiplexed ? " + " : "",
+           (services & SERVICE_LOCATION) ? CHANNEL_LOCATION : "");
+
+    while (1) {
+        if (upgrade_requested) hand_off_listener(server_fd, upgrade_fd, services);
+
+        // Selama jendela upgrade, terima juga koneksi yang dipindahkan dari proses lama
+        if (upgrade_fd >= 0) {
+            if (now_ms() >= upgrade_until) {
+                close(upgrade_fd);
+                upgrade_fd = -1;
+                continue;
+            }
+
+            struct pollfd fds[2] = { { server_fd, POLLIN, 0 }, { upgrade_fd, POLLIN, 0 } };
+            if (poll(fds, 2, 1000) <= 0) continue;
+            if (fds[1].revents & POLLIN) adopt_connection(server_fd, upgrade_fd, services);
+            if (!(fds[0].revents & POLLIN)) continue;
+        }
+
+        new_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t *)&addrlen);
+        if (new_socket < 0) continue;
+
+        // Buang beban sebelum fork jika batas koneksi atau handshake sudah tercapai
+        if (admission_try_accept() < 0) {
+            admission_reject(new_socket);
+            close(new_socket);
+            continue;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            signal(SIGUSR2, SIG_IGN);
+            close(server_fd);
+            if (upgrade_fd >= 0) close(upgrade_fd);
+            handle_client(new_socket, services);
+            exit(0);
+        } else if (pid < 0) {
+            admission_handshake_done();
+            admission_release();
+        }
+        close(new_socket);
+    }
+
+    return 0;
+}
+
+// Pemakaian: ./server [--chat | --location] [--port N] [--upgrade]
+// Tanpa opsi, chat dan lokasi dilayani bersama lewat satu koneksi WebSocket.
+// --upgrade mengambil alih soket dan koneksi dari server yang sedang berjalan di port yang sama.
+int main(int argc, char *argv[]) {
+    int port = PORT;
+    int services = SERVICE_CHAT | SERVICE_LOCATION;
+    int upgrading = 0;
+
+    // Line buffered agar log tidak tercetak ganda saat proses di-fork dengan output dialihkan
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--chat") == 0) {
+            services = SERVICE_CHAT;
+        } else if (strcmp(argv[i], "--location") == 0) {
+            services = SERVICE_LOCATION;
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--upgrade") == 0) {
+            upgrading = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [--chat | --location] [--port N] [--upgrade]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    return server_run(port, services, upgrading);
+}
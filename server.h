@@ -0,0 +1,62 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <cjson/cJSON.h>
+#include "outq.h"
+#include "ratelimit.h"
+#include "track.h"
+#include "websocket.h"
+
+#define PORT 8080
+#define BUFFER_SIZE 1024
+#define POLL_INTERVAL_MS 1000   // Jeda membaca ulang file data di proses pengirim
+#define DRAIN_TIMEOUT_MS 1000   // Batas waktu mengosongkan antrian setelah pembaca selesai
+
+// Layanan yang bisa dijalankan dalam satu proses server
+#define SERVICE_CHAT 0x1
+#define SERVICE_LOCATION 0x2
+
+#define CHANNEL_CHAT "chat"
+#define CHANNEL_LOCATION "location"
+
+// State satu koneksi WebSocket, dipakai bersama oleh semua layanan
+struct connection {
+    int client_fd;
+    int services;
+    char username[BUFFER_SIZE];
+    ws_reader reader;
+    token_bucket buckets[RATE_KINDS];
+    rate_violations violations;
+
+    // Proses pembaca meneruskan frame lewat notify_fd; proses pengirim memegang antrian
+    int notify_fd;
+    struct outq *outq;
+
+    // State pengirim layanan chat
+    long chat_last_index;
+    char chat_join_time[9];
+
+    // State layanan lokasi
+    cJSON *location_snapshot;
+    track_writer track;
+};
+
+// Deklarasi fungsi yang ada di server.c
+int server_send_frame(struct connection *conn, enum outq_class cls, const char *key, const char *frame, size_t length);
+int server_send_json(struct connection *conn, const char *channel, const char *key, cJSON *object);
+
+// Deklarasi fungsi yang ada di server_chat.c
+void chat_initialize(void);
+int chat_connect(struct connection *conn, cJSON *json);
+void chat_disconnect(struct connection *conn);
+void chat_handle_message(struct connection *conn, cJSON *json);
+void chat_poll(struct connection *conn);
+
+// Deklarasi fungsi yang ada di server_location.c
+void location_initialize(void);
+int location_connect(struct connection *conn, cJSON *json);
+void location_handle_message(struct connection *conn, cJSON *json);
+void location_poll(struct connection *conn);
+void location_forget(struct connection *conn, const char *username);
+
+#endif
@@ -2,21 +2,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <arpa/inet.h>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <signal.h>
-#include "websocket.h"
+#include <sys/file.h>
+#include "search_index.h"
+#include "server.h"
 #include <cjson/cJSON.h>
 #include <time.h>
 
-#define PORT 8080
-#define BUFFER_SIZE 1024
 #define CHAT_FILE "data/chats.json"
 #define USER_FILE "data/users.json"
+#define SEARCH_PAGE_SIZE 20
+#define SEARCH_MAX_PAGE_SIZE 50
 
 // Initialize JSON files
-void initialize_files() {
+void chat_initialize(void) {
     FILE *file = fopen(CHAT_FILE, "w");
     if (file) {
         fprintf(file, "[]"); // Initialize empty JSON array
@@ -27,6 +25,7 @@ void initialize_files() {
         fprintf(file, "[]"); // Initialize empty JSON array
         fclose(file);
     }
+    index_reset();
 }
 
 // Fungsi untuk mengonversi waktu dalam format HH:MM:SS ke time_t
@@ -125,9 +124,9 @@ void save_username(const char *username) {
     fclose(file);
 }
 
-// Save message to JSON file
-void save_message(const char *username, const char *message, const char *type) {
-    FILE *file = fopen(CHAT_FILE, "r+");
+// Remove username from JSON file saat koneksi berakhir agar nama bisa dipakai lagi
+void remove_username(const char *username) {
+    FILE *file = fopen(USER_FILE, "r");
     if (!file) return;
 
     fseek(file, 0, SEEK_END);
@@ -137,6 +136,42 @@ void save_message(const char *username, const char *message, const char *type) {
     char buffer[file_size + 1];
     fread(buffer, 1, file_size, file);
     buffer[file_size] = '\0';
+    fclose(file);
+
+    cJSON *user_array = cJSON_Parse(buffer);
+    if (!user_array) return;
+
+    // Bangun array baru tanpa username yang keluar
+    cJSON *remaining = cJSON_CreateArray();
+    cJSON *user;
+    cJSON_ArrayForEach(user, user_array) {
+        const char *stored_username = cJSON_GetStringValue(cJSON_GetObjectItem(user, "username"));
+        if (stored_username && strcmp(stored_username, username) == 0) continue;
+        cJSON_AddItemToArray(remaining, cJSON_Duplicate(user, 1));
+    }
+
+    file = fopen(USER_FILE, "w");
+    if (file) {
+        char *json_string = cJSON_Print(remaining);
+        fprintf(file, "%s", json_string);
+        free(json_string);
+        fclose(file);
+    }
+
+    cJSON_Delete(remaining);
+    cJSON_Delete(user_array);
+}
+
+// Save message to JSON file
+void save_message(const char *username, const char *message, const char *type) {
+    FILE *file = fopen(CHAT_FILE, "r+");
+    if (!file) return;
+
+    // Kunci file agar penulis lain tidak menyela dan urutan seq indeks sama dengan urutan pesan
+    flock(fileno(file), LOCK_EX);
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
 
     // Get current time
     time_t raw_time;
@@ -147,222 +182,186 @@ void save_message(const char *username, const char *message, const char *type) {
     time_info = localtime(&raw_time);
     strftime(time_str, sizeof(time_str), "%H:%M:%S", time_info);
 
-    FILE *output = fopen(CHAT_FILE, "w");
-    if (!output) {
-        fclose(file);
-        return;
-    }
-
+    // Tambahkan pesan di tempat (menimpa ']' penutup) tanpa menulis ulang seluruh riwayat,
+    // sehingga offset setiap pesan di file tetap dan bisa dipakai indeks pencarian
+    long offset;
     if (file_size > 2) { // If JSON array is not empty
-        buffer[file_size - 1] = '\0'; // Remove closing bracket
-        fprintf(output, "%s,{\"username\":\"%s\",\"message\":\"%s\",\"time\":\"%s\",\"type\":\"%s\"}]", buffer, username, message, time_str, type);
+        fseek(file, file_size - 1, SEEK_SET);
+        fputc(',', file);
+        offset = file_size;
     } else {
-        fprintf(output, "[{\"username\":\"%s\",\"message\":\"%s\",\"time\":\"%s\",\"type\":\"%s\"}]", username, message, time_str, type);
+        fseek(file, 0, SEEK_SET);
+        fputc('[', file);
+        offset = 1;
     }
+    fprintf(file, "{\"username\":\"%s\",\"message\":\"%s\",\"time\":\"%s\",\"type\":\"%s\"}]", username, message, time_str, type);
+    fflush(file);
+
+    // Hanya pesan chat yang dicari; pengumuman tetap mendapat seq agar seq = indeks array
+    index_add_message(offset, strcmp(type, "message") == 0 ? message : NULL);
 
+    flock(fileno(file), LOCK_UN);
     fclose(file);
-    fclose(output);
 }
 
-// Handle client connection
-void handle_client(int client_fd) {
-    char buffer[BUFFER_SIZE], message[BUFFER_SIZE];
-    char username[BUFFER_SIZE] = {0};
-    time_t join_time;
-    struct tm *join_time_info;
-    char time_str[9];
+// Baca satu pesan dari chats.json berdasarkan seq tanpa mem-parsing seluruh riwayat
+cJSON *load_message(long seq) {
+    long offset = index_message_offset(seq);
+    if (offset < 0) return NULL;
 
-    // Lakukan WebSocket handshake
-    if (recv(client_fd, buffer, BUFFER_SIZE, 0) <= 0 || handle_handshake(client_fd, buffer) < 0) {
-        close(client_fd);
-        return;
-    }
+    FILE *file = fopen(CHAT_FILE, "r");
+    if (!file) return NULL;
 
-    // Terima pesan koneksi awal dari klien
-    recv(client_fd, buffer, BUFFER_SIZE, 0);
-    websocket_decode(buffer, message);
+    char buffer[4 * BUFFER_SIZE];
+    fseek(file, offset, SEEK_SET);
+    size_t length = fread(buffer, 1, sizeof(buffer) - 1, file);
+    buffer[length] = '\0';
+    fclose(file);
 
-    // Parse JSON untuk mendapatkan username
-    cJSON *json = cJSON_Parse(message);
-    if (!json) {
-        close(client_fd);
-        return;
-    }
+    return cJSON_ParseWithOpts(buffer, NULL, 0);
+}
 
-    const char *type = cJSON_GetStringValue(cJSON_GetObjectItem(json, "type"));
-    if (strcmp(type, "connect") == 0) {
-        const char *received_username = cJSON_GetStringValue(cJSON_GetObjectItem(json, "username"));
-
-        // Periksa apakah username sudah digunakan
-        if (is_username_used(received_username)) {
-            printf("Username %s already in use\n", received_username);
-
-            // Kirim pesan error ke klien
-            cJSON *error_response = cJSON_CreateObject();
-            cJSON_AddStringToObject(error_response, "type", "error");
-            cJSON_AddStringToObject(error_response, "message", "Username is already in use.");
-            char *error_message = cJSON_Print(error_response);
-            char frame[BUFFER_SIZE];
-            int frame_len = websocket_encode(error_message, frame);
-            send(client_fd, frame, frame_len, 0);
-
-            free(error_message);
-            cJSON_Delete(error_response);
-            cJSON_Delete(json);
-
-            close(client_fd);
-            return;
+// Jawab permintaan pencarian: {"type":"search","query":"...","before":seq,"limit":n}
+void send_search_results(struct connection *conn, cJSON *request) {
+    const char *query = cJSON_GetStringValue(cJSON_GetObjectItem(request, "query"));
+    cJSON *before_item = cJSON_GetObjectItem(request, "before");
+    cJSON *limit_item = cJSON_GetObjectItem(request, "limit");
+
+    long before = cJSON_IsNumber(before_item) ? (long)cJSON_GetNumberValue(before_item) : -1;
+    int limit = cJSON_IsNumber(limit_item) ? (int)cJSON_GetNumberValue(limit_item) : SEARCH_PAGE_SIZE;
+    if (limit < 1) limit = 1;
+    if (limit > SEARCH_MAX_PAGE_SIZE) limit = SEARCH_MAX_PAGE_SIZE;
+
+    long seqs[SEARCH_MAX_PAGE_SIZE];
+    int count = query ? index_search(query, before, limit, seqs) : 0;
+
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "type", "search_result");
+    cJSON_AddStringToObject(response, "query", query ? query : "");
+    cJSON *results = cJSON_AddArrayToObject(response, "results");
+
+    for (int i = 0; i < count; i++) {
+        cJSON *message_obj = load_message(seqs[i]);
+        const char *text = cJSON_GetStringValue(cJSON_GetObjectItem(message_obj, "message"));
+
+        // Buang tabrakan hash dari indeks dengan mencocokkan ulang teks aslinya
+        if (text && index_matches(text, query)) {
+            cJSON_AddNumberToObject(message_obj, "seq", seqs[i]);
+            cJSON_AddItemToArray(results, message_obj);
+        } else {
+            cJSON_Delete(message_obj);
         }
+    }
 
-        // Simpan username
-        strncpy(username, received_username, BUFFER_SIZE);
-        save_username(username);
+    // Halaman berikutnya dimulai sebelum seq terakhir yang diperiksa
+    cJSON_AddNumberToObject(response, "next_before", count == limit ? seqs[count - 1] : -1);
 
-        printf("New client connected: %s\n", username);
+    server_send_json(conn, CHANNEL_CHAT, NULL, response);
+    cJSON_Delete(response);
+}
 
-        save_message(username, "bergabung!", "announcement");  // Menyimpan pengumuman ke file chats.json
-        time(&join_time);
-        join_time_info = localtime(&join_time);
-        strftime(time_str, sizeof(time_str), "%H:%M:%S", join_time_info);
+// Daftarkan username saat koneksi dibuka; ditolak jika username sudah dipakai
+int chat_connect(struct connection *conn, cJSON *json) {
+    // Pemanggil sudah memastikan pesan pertama bertipe connect
+    (void)json;
+
+    // Periksa apakah username sudah digunakan
+    if (is_username_used(conn->username)) {
+        printf("Username %s already in use\n", conn->username);
+
+        // Kirim pesan error ke klien
+        cJSON *error_response = cJSON_CreateObject();
+        cJSON_AddStringToObject(error_response, "type", "error");
+        cJSON_AddStringToObject(error_response, "message", "Username is already in use.");
+        server_send_json(conn, CHANNEL_CHAT, NULL, error_response);
+        cJSON_Delete(error_response);
+        return -1;
     }
 
-    cJSON_Delete(json);
-
+    // Simpan username
+    save_username(conn->username);
+    save_message(conn->username, "bergabung!", "announcement");  // Menyimpan pengumuman ke file chats.json
 
-    pid_t pid = fork();
+    time_t join_time;
+    time(&join_time);
+    strftime(conn->chat_join_time, sizeof(conn->chat_join_time), "%H:%M:%S", localtime(&join_time));
+    return 0;
+}
 
-    if (pid == 0) {
-        // Handle client messages
-        while (1) {
-            int bytes_received = recv(client_fd, buffer, BUFFER_SIZE, 0);
-            if (bytes_received <= 0) break;
+void chat_disconnect(struct connection *conn) {
+    if (conn->chat_join_time[0]) remove_username(conn->username);
+}
 
-            websocket_decode(buffer, message);
+// Pesan dari klien: kirim chat atau cari riwayat
+void chat_handle_message(struct connection *conn, cJSON *json) {
+    const char *type = cJSON_GetStringValue(cJSON_GetObjectItem(json, "type"));
+    if (!type) return;
 
-            json = cJSON_Parse(message);
-            if (!json) continue;
+    if (strcmp(type, "search") == 0) {
+        send_search_results(conn, json);
+    } else if (strcmp(type, "message") == 0) {
+        const char *msg_message = cJSON_GetStringValue(cJSON_GetObjectItem(json, "message"));
+        if (msg_message) save_message(conn->username, msg_message, "message");
+    }
+}
 
-            const char *type = cJSON_GetStringValue(cJSON_GetObjectItem(json, "type"));
-            if (strcmp(type, "message") == 0) {
-                const char *username = cJSON_GetStringValue(cJSON_GetObjectItem(json, "username"));
-                const char *message = cJSON_GetStringValue(cJSON_GetObjectItem(json, "message"));
-                save_message(username, message, "message");
-            }
+// Kirim pesan baru dari chats.json yang belum diterima klien
+void chat_poll(struct connection *conn) {
+    FILE *file = fopen(CHAT_FILE, "r");
+    if (!file) {
+        perror("Failed to open chat file");
+        return;
+    }
 
-            cJSON_Delete(json);
-        }
+    // Baca seluruh isi file
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
 
-        close(client_fd);
-        exit(0);
-    } else if (pid > 0) {
-        int last_index = 0; // Indeks pesan terakhir yang sudah dikirim
-
-        while (1) {
-            FILE *file = fopen(CHAT_FILE, "r");
-            if (!file) {
-                perror("Failed to open chat file");
-                return;
-            }
-
-            // Baca seluruh isi file
-            fseek(file, 0, SEEK_END);
-            long file_size = ftell(file);
-            fseek(file, 0, SEEK_SET);
-
-            char *file_content = malloc(file_size + 1);
-            if (!file_content) {
-                perror("Failed to allocate memory for file content");
-                fclose(file);
-                return;
-            }
-
-            fread(file_content, 1, file_size, file);
-            file_content[file_size] = '\0';
-            fclose(file);
-
-            // Parse JSON array
-            cJSON *json_array = cJSON_Parse(file_content);
-            free(file_content);
-
-            if (!json_array) {
-                fprintf(stderr, "Failed to parse JSON\n");
-                sleep(1);
-                continue;
-            }
-
-            int array_size = cJSON_GetArraySize(json_array);
-
-            // Kirim hanya pesan baru yang belum dikirimkan
-            for (int i = last_index; i < array_size; i++) {
-                cJSON *message_obj = cJSON_GetArrayItem(json_array, i);
-                if (!message_obj) continue;
-
-                // Ambil elemen JSON
-                const char *msg_username = cJSON_GetStringValue(cJSON_GetObjectItem(message_obj, "username"));
-                const char *msg_message = cJSON_GetStringValue(cJSON_GetObjectItem(message_obj, "message"));
-                const char *msg_time = cJSON_GetStringValue(cJSON_GetObjectItem(message_obj, "time"));
-                const char *msg_type = cJSON_GetStringValue(cJSON_GetObjectItem(message_obj, "type"));
-
-                // Konversi waktu pesan ke time_t
-                time_t message_time = convert_time_to_t(msg_time);
-                time_t sjoin_time = convert_time_to_t(time_str);
-
-                // Kirim hanya jika waktu pesan setelah waktu bergabung klien dan bukan pesan dengan usernamenya sendiri
-                if(msg_username && strcmp(msg_username, username) != 0 && difftime(message_time, sjoin_time) > 0) {
-                    char *message_json = cJSON_Print(message_obj);
-                    if (message_json) {
-                        char frame[BUFFER_SIZE];
-                        int frame_len = websocket_encode(message_json, frame);
-                        send(client_fd, frame, frame_len, 0);
-                        free(message_json);
-                    }
-                }
-            }
-
-            // Update indeks pesan terakhir yang sudah dikirim
-            last_index = array_size;
-
-            cJSON_Delete(json_array);
-
-            // Tunggu sebelum membaca file lagi
-            sleep(1);
-        }
+    char *file_content = malloc(file_size + 1);
+    if (!file_content) {
+        perror("Failed to allocate memory for file content");
+        fclose(file);
+        return;
     }
-}
 
+    fread(file_content, 1, file_size, file);
+    file_content[file_size] = '\0';
+    fclose(file);
 
-int main() {
-    initialize_files();
-
-    int server_fd, new_socket;
-    struct sockaddr_in address;
-    int opt = 1;
-    socklen_t addrlen = sizeof(address);
+    // Parse JSON array
+    cJSON *json_array = cJSON_Parse(file_content);
+    free(file_content);
 
-    // Signal handler to reap zombie processes
-    signal(SIGCHLD, SIG_IGN);
+    if (!json_array) {
+        fprintf(stderr, "Failed to parse JSON\n");
+        return;
+    }
 
-    server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt));
+    int array_size = cJSON_GetArraySize(json_array);
+    time_t sjoin_time = convert_time_to_t(conn->chat_join_time);
 
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(PORT);
+    // Kirim hanya pesan baru yang belum dikirimkan
+    for (int i = conn->chat_last_index; i < array_size; i++) {
+        cJSON *message_obj = cJSON_GetArrayItem(json_array, i);
+        if (!message_obj) continue;
 
-    bind(server_fd, (struct sockaddr *)&address, sizeof(address));
-    listen(server_fd, 10);
+        // Ambil elemen JSON
+        const char *msg_username = cJSON_GetStringValue(cJSON_GetObjectItem(message_obj, "username"));
+        const char *msg_time = cJSON_GetStringValue(cJSON_GetObjectItem(message_obj, "time"));
+        if (!msg_username || !msg_time) continue;
 
-    printf("Server is running on port %d\n", PORT);
+        // Konversi waktu pesan ke time_t
+        time_t message_time = convert_time_to_t(msg_time);
 
-    while (1) {
-        new_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t *)&addrlen);
-        if (fork() == 0) {
-            close(server_fd);
-            handle_client(new_socket);
-            exit(0);
+        // Kirim hanya jika waktu pesan setelah waktu bergabung klien dan bukan pesan dengan usernamenya sendiri
+        if (strcmp(msg_username, conn->username) != 0 && difftime(message_time, sjoin_time) > 0) {
+            server_send_json(conn, CHANNEL_CHAT, NULL, message_obj);
         }
-        close(new_socket);
     }
 
-    return 0;
+    // Update indeks pesan terakhir yang sudah dikirim
+    conn->chat_last_index = array_size;
+
+    cJSON_Delete(json_array);
 }
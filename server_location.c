@@ -2,27 +2,22 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <arpa/inet.h>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <signal.h>
-#include "websocket.h"
+#include "server.h"
+#include "track.h"
 #include <cjson/cJSON.h>
 
-#define PORT 8080
-#define BUFFER_SIZE 1024
-#define MAX_CLIENTS 10
 #define LOCATION_FILE "data/locations.json"
-
-int client_sockets[MAX_CLIENTS] = {0};  // Array untuk menyimpan soket klien
+#define TRACK_CHUNK_POINTS 64      // Titik per frame saat mengalirkan hasil query track
+#define TRACK_DEFAULT_POINTS 1000  // Juga batas atas max_points dari klien
 
 // Initialize JSON files
-void initialize_files() {
+void location_initialize(void) {
     FILE *file = fopen(LOCATION_FILE, "w");
     if (file) {
         fprintf(file, "[]"); // Initialize empty JSON array
         fclose(file);
     }
+    track_reset();
 }
 
 // Fungsi untuk menyimpan atau memperbarui lokasi berdasarkan username
@@ -92,186 +87,168 @@ write_file:
     cJSON_Delete(json_array);
 }
 
+// State pengiriman hasil query track secara bertahap
+struct track_stream {
+    struct connection *conn;
+    const char *username;
+    cJSON *points;
+    int count;
+};
+
+// Kirim titik yang terkumpul sebagai satu frame {"type":"track","points":[[t,lat,lon],...],"done":...}
+void flush_track_chunk(struct track_stream *stream, int done) {
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "type", "track");
+    cJSON_AddStringToObject(response, "username", stream->username);
+    cJSON_AddItemToObject(response, "points", stream->points);
+    cJSON_AddBoolToObject(response, "done", done);
+
+    server_send_json(stream->conn, CHANNEL_LOCATION, NULL, response);
+    cJSON_Delete(response);
+
+    stream->points = cJSON_CreateArray();
+    stream->count = 0;
+}
 
-// Handle client connection
-void handle_client(int client_fd) {
-    char buffer[BUFFER_SIZE], message[BUFFER_SIZE];
-    char username[BUFFER_SIZE] = {0};
-
-    // Lakukan WebSocket handshake
-    if (recv(client_fd, buffer, BUFFER_SIZE, 0) <= 0 || handle_handshake(client_fd, buffer) < 0) {
-        close(client_fd);
-        return;
-    }
-
-    // Terima pesan koneksi awal dari klien
-    recv(client_fd, buffer, BUFFER_SIZE, 0);
-    websocket_decode(buffer, message);
+void stream_track_point(const track_point *point, void *context) {
+    struct track_stream *stream = context;
+    cJSON *item = cJSON_CreateArray();
 
-    // Parse JSON untuk mendapatkan username
-    cJSON *json = cJSON_Parse(message);
-    if (!json) {
-        close(client_fd);
-        return;
-    }
+    cJSON_AddItemToArray(item, cJSON_CreateNumber((double)point->t));
+    cJSON_AddItemToArray(item, cJSON_CreateNumber(point->lat / TRACK_COORD_SCALE));
+    cJSON_AddItemToArray(item, cJSON_CreateNumber(point->lon / TRACK_COORD_SCALE));
+    cJSON_AddItemToArray(stream->points, item);
 
-    const char *received_username = cJSON_GetStringValue(cJSON_GetObjectItem(json, "username"));
-    double received_lat = cJSON_GetNumberValue(cJSON_GetObjectItem(json, "lat"));
-    double received_lon = cJSON_GetNumberValue(cJSON_GetObjectItem(json, "lon"));
+    if (++stream->count == TRACK_CHUNK_POINTS) flush_track_chunk(stream, 0);
+}
 
-    // Simpan username
-    save_location(received_username, received_lat, received_lon);
-    printf("New client connected: %s\n", username);
+// Jawab query {"type":"track","username":"...","from":ms,"to":ms,"max_points":n}
+void send_track(struct connection *conn, cJSON *request) {
+    const char *username = cJSON_GetStringValue(cJSON_GetObjectItem(request, "username"));
+    cJSON *from_item = cJSON_GetObjectItem(request, "from");
+    cJSON *to_item = cJSON_GetObjectItem(request, "to");
+    cJSON *max_item = cJSON_GetObjectItem(request, "max_points");
+    if (!username) return;
+
+    int64_t from = cJSON_IsNumber(from_item) ? (int64_t)cJSON_GetNumberValue(from_item) : 0;
+    int64_t to = cJSON_IsNumber(to_item) ? (int64_t)cJSON_GetNumberValue(to_item) : INT64_MAX;
+    long max_points = cJSON_IsNumber(max_item) ? (long)cJSON_GetNumberValue(max_item) : TRACK_DEFAULT_POINTS;
+
+    // max_points <= 0 berarti semua titik bagi track_query; klien tidak boleh meminta seluruh riwayat
+    if (max_points <= 0 || max_points > TRACK_DEFAULT_POINTS) max_points = TRACK_DEFAULT_POINTS;
+
+    struct track_stream stream = { conn, username, cJSON_CreateArray(), 0 };
+    track_query(username, from, to, max_points, stream_track_point, &stream);
+    flush_track_chunk(&stream, 1);
+    cJSON_Delete(stream.points);
+}
 
-    cJSON_Delete(json);
+// Simpan posisi awal (jika dikirim bersama pesan koneksi) dan siapkan riwayat pengguna
+int location_connect(struct connection *conn, cJSON *json) {
+    cJSON *lat = cJSON_GetObjectItem(json, "lat");
+    cJSON *lon = cJSON_GetObjectItem(json, "lon");
 
-    // Simpan client socket
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (client_sockets[i] == 0) {
-            client_sockets[i] = client_fd;
-            break;
-        }
+    track_writer_init(&conn->track, conn->username);
+    if (cJSON_IsNumber(lat) && cJSON_IsNumber(lon) &&
+        track_valid_coordinates(cJSON_GetNumberValue(lat), cJSON_GetNumberValue(lon))) {
+        save_location(conn->username, cJSON_GetNumberValue(lat), cJSON_GetNumberValue(lon));
+        track_append(&conn->track, track_now_ms(), cJSON_GetNumberValue(lat), cJSON_GetNumberValue(lon));
     }
+    return 0;
+}
 
-    pid_t pid = fork();
-
-    if (pid == 0) {
-        // Handle client messages
-        while (1) {
-            int bytes_received = recv(client_fd, buffer, BUFFER_SIZE, 0);
-            if (bytes_received <= 0) break;
-
-            websocket_decode(buffer, message);
-
-            json = cJSON_Parse(message);
-            if (!json) continue;
-
-            const char *username = cJSON_GetStringValue(cJSON_GetObjectItem(json, "username"));
-            double lat = cJSON_GetNumberValue(cJSON_GetObjectItem(json, "lat"));
-            double lon = cJSON_GetNumberValue(cJSON_GetObjectItem(json, "lon"));
-
-            // Simpan lokasi ke file JSON
-            save_location(username, lat, lon);
+// Pesan dari klien: update posisi atau query riwayat
+void location_handle_message(struct connection *conn, cJSON *json) {
+    const char *type = cJSON_GetStringValue(cJSON_GetObjectItem(json, "type"));
+    if (type && strcmp(type, "track") == 0) {
+        send_track(conn, json);
+        return;
+    }
 
-            cJSON_Delete(json);
-        }
+    cJSON *lat = cJSON_GetObjectItem(json, "lat");
+    cJSON *lon = cJSON_GetObjectItem(json, "lon");
+    if (!cJSON_IsNumber(lat) || !cJSON_IsNumber(lon)) return;
+    if (!track_valid_coordinates(cJSON_GetNumberValue(lat), cJSON_GetNumberValue(lon))) return;
 
-        close(client_fd);
-        exit(0);
-    } else if (pid > 0) {
-    int last_index = 0; // Indeks pesan terakhir yang sudah dikirim
-    cJSON *last_json_array = NULL;  // Menyimpan data JSON array terakhir
+    // Simpan lokasi ke file JSON dan riwayat pergerakan pengguna
+    save_location(conn->username, cJSON_GetNumberValue(lat), cJSON_GetNumberValue(lon));
+    track_append(&conn->track, track_now_ms(), cJSON_GetNumberValue(lat), cJSON_GetNumberValue(lon));
+}
 
-    while (1) {
-        FILE *file = fopen(LOCATION_FILE, "r");
-        if (!file) {
-            perror("Failed to open chat file");
-            return;
-        }
+static cJSON *find_location(cJSON *json_array, const char *username) {
+    cJSON *item;
+    cJSON_ArrayForEach(item, json_array) {
+        const char *stored_username = cJSON_GetStringValue(cJSON_GetObjectItem(item, "username"));
+        if (stored_username && strcmp(stored_username, username) == 0) return item;
+    }
+    return NULL;
+}
 
-        // Baca seluruh isi file
-        fseek(file, 0, SEEK_END);
-        long file_size = ftell(file);
-        fseek(file, 0, SEEK_SET);
+// Kirim lokasi pengguna lain yang baru atau berubah sejak putaran sebelumnya
+void location_poll(struct connection *conn) {
+    FILE *file = fopen(LOCATION_FILE, "r");
+    if (!file) {
+        perror("Failed to open location file");
+        return;
+    }
 
-        char *file_content = malloc(file_size + 1);
-        if (!file_content) {
-            perror("Failed to allocate memory for file content");
-            fclose(file);
-            return;
-        }
+    // Baca seluruh isi file
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
 
-        fread(file_content, 1, file_size, file);
-        file_content[file_size] = '\0';
+    char *file_content = malloc(file_size + 1);
+    if (!file_content) {
+        perror("Failed to allocate memory for file content");
         fclose(file);
-
-        // Parse JSON array
-        cJSON *json_array = cJSON_Parse(file_content);
-        free(file_content);
-
-        if (!json_array) {
-            fprintf(stderr, "Failed to parse JSON\n");
-            sleep(1);
-            continue;
-        }
-
-        int array_size = cJSON_GetArraySize(json_array);
-
-        // Cek apakah ada perubahan data dibandingkan dengan data sebelumnya
-        if (last_json_array == NULL || !cJSON_Compare(json_array, last_json_array, 1)) {
-            // Kirim data yang berubah
-            for (int i = last_index; i < array_size; i++) {
-                cJSON *message_obj = cJSON_GetArrayItem(json_array, i);
-                if (!message_obj) continue;
-
-                // Ambil elemen JSON
-                const char *msg_username = cJSON_GetStringValue(cJSON_GetObjectItem(message_obj, "username"));
-                const char *msg_lat = cJSON_GetStringValue(cJSON_GetObjectItem(message_obj, "lat"));
-                const char *msg_lon = cJSON_GetStringValue(cJSON_GetObjectItem(message_obj, "lon"));
-
-                // Kirim hanya jika bukan pesan dengan usernamenya sendiri
-                if (msg_username && strcmp(msg_username, username) != 0) {
-                    char *message_json = cJSON_Print(message_obj);
-                    if (message_json) {
-                        char frame[BUFFER_SIZE];
-                        int frame_len = websocket_encode(message_json, frame);
-                        send(client_fd, frame, frame_len, 0);
-                        free(message_json);
-                    }
-                }
-            }
-
-            // Update indeks pesan terakhir yang sudah dikirim
-            last_index = array_size;
-        }
-
-        // Simpan data JSON array untuk perbandingan pada iterasi berikutnya
-        if (last_json_array) {
-            cJSON_Delete(last_json_array);
-        }
-        last_json_array = cJSON_Duplicate(json_array, 1);  // Salin array JSON untuk perbandingan berikutnya
-
-        cJSON_Delete(json_array);
-
-        // Tunggu sebelum membaca file lagi
-        sleep(1);
+        return;
     }
-}
 
-}
+    fread(file_content, 1, file_size, file);
+    file_content[file_size] = '\0';
+    fclose(file);
 
-int main() {
-    initialize_files();
+    // Parse JSON array
+    cJSON *json_array = cJSON_Parse(file_content);
+    free(file_content);
 
-    int server_fd, new_socket;
-    struct sockaddr_in address;
-    int opt = 1;
-    socklen_t addrlen = sizeof(address);
+    if (!json_array) {
+        fprintf(stderr, "Failed to parse JSON\n");
+        return;
+    }
 
-    // Signal handler to reap zombie processes
-    signal(SIGCHLD, SIG_IGN);
+    // Snapshot baru dipasang sebelum mengirim: update yang dibuang outq selama putaran ini
+    // memanggil location_forget pada snapshot baru, sehingga putaran berikutnya mengirim ulang.
+    // Salinan dipakai agar item yang sedang diiterasi tidak ikut terhapus.
+    cJSON *previous_snapshot = conn->location_snapshot;
+    conn->location_snapshot = cJSON_Duplicate(json_array, 1);
 
-    server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt));
+    cJSON *item;
+    cJSON_ArrayForEach(item, json_array) {
+        const char *msg_username = cJSON_GetStringValue(cJSON_GetObjectItem(item, "username"));
 
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(PORT);
+        // Kirim hanya jika bukan lokasinya sendiri dan datanya berubah
+        if (!msg_username || strcmp(msg_username, conn->username) == 0) continue;
+        cJSON *previous = find_location(previous_snapshot, msg_username);
+        if (previous && cJSON_Compare(item, previous, 1)) continue;
 
-    bind(server_fd, (struct sockaddr *)&address, sizeof(address));
-    listen(server_fd, 10);
+        server_send_json(conn, CHANNEL_LOCATION, msg_username, item);
+    }
 
-    printf("Server is running on port %d\n", PORT);
+    cJSON_Delete(previous_snapshot);
+    cJSON_Delete(json_array);
+}
 
-    while (1) {
-        new_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t *)&addrlen);
-        if (fork() == 0) {
-            close(server_fd);
-            handle_client(new_socket);
-            exit(0);
+// Lupakan posisi yang sudah dianggap terkirim agar putaran berikutnya mengirim posisi terbaru
+void location_forget(struct connection *conn, const char *username) {
+    int index = 0;
+    cJSON *item;
+    cJSON_ArrayForEach(item, conn->location_snapshot) {
+        const char *stored_username = cJSON_GetStringValue(cJSON_GetObjectItem(item, "username"));
+        if (stored_username && strcmp(stored_username, username) == 0) {
+            cJSON_DeleteItemFromArray(conn->location_snapshot, index);
+            return;
         }
-        close(new_socket);
+        index++;
     }
-
-    return 0;
 }
@@ -0,0 +1,507 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "track.h"
+
+#define BLOCK_DOWNSAMPLED 0x01
+#define METERS_PER_MICRODEGREE 0.111320
+
+// Header setiap blok; titik pertama disimpan utuh, titik berikutnya sebagai bitstream
+struct block_header {
+    int64_t t_first;
+    int64_t t_last;
+    int32_t lat_first;
+    int32_t lon_first;
+    uint16_t count;
+    uint16_t bits;
+    uint8_t flags;
+    uint8_t reserved[3];
+};
+
+#define BLOCK_PAYLOAD_BITS ((TRACK_BLOCK_SIZE - sizeof(struct block_header)) * 8)
+#define MAX_BLOCK_POINTS (BLOCK_PAYLOAD_BITS / 3 + 1)
+
+// Lebar bucket untuk nilai bertanda: '0' = nol, '10' = 6 bit, '110' = 9 bit, '1110' = 13 bit, '1111' = 32 bit
+static const int bucket_bits[] = { 6, 9, 13 };
+
+int64_t track_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+// ---------------------------------------------------------------------------
+// Bitstream
+
+static void put_bits(unsigned char *data, uint16_t *position, uint64_t value, int n) {
+    for (int i = n - 1; i >= 0; i--) {
+        if ((value >> i) & 1) data[*position / 8] |= 0x80 >> (*position % 8);
+        (*position)++;
+    }
+}
+
+static uint64_t get_bits(const unsigned char *data, uint32_t *position, int n) {
+    uint64_t value = 0;
+    for (int i = 0; i < n; i++) {
+        value = (value << 1) | ((data[*position / 8] >> (7 - *position % 8)) & 1);
+        (*position)++;
+    }
+    return value;
+}
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static int signed_bits(int64_t value) {
+    if (value == 0) return 1;
+    for (int i = 0; i < 3; i++) {
+        int64_t limit = 1LL << (bucket_bits[i] - 1);
+        if (value >= -limit && value < limit) return i + 2 + bucket_bits[i];
+    }
+    return 4 + 32;
+}
+
+static void put_signed(unsigned char *data, uint16_t *position, int64_t value) {
+    if (value == 0) {
+        put_bits(data, position, 0, 1);
+        return;
+    }
+    for (int i = 0; i < 3; i++) {
+        int64_t limit = 1LL << (bucket_bits[i] - 1);
+        if (value >= -limit && value < limit) {
+            put_bits(data, position, ((1u << (i + 1)) - 1) << 1, i + 2);
+            put_bits(data, position, zigzag(value), bucket_bits[i]);
+            return;
+        }
+    }
+    put_bits(data, position, 0xF, 4);
+    put_bits(data, position, zigzag(value), 32);
+}
+
+static int64_t get_signed(const unsigned char *data, uint32_t *position) {
+    int ones = 0;
+    while (ones < 4 && get_bits(data, position, 1)) ones++;
+    if (ones == 0) return 0;
+    if (ones == 4) return unzigzag(get_bits(data, position, 32));
+    return unzigzag(get_bits(data, position, bucket_bits[ones - 1]));
+}
+
+// ---------------------------------------------------------------------------
+// Encoder/decoder blok: delta-of-delta untuk waktu, delta untuk koordinat
+
+static void start_block(track_writer *writer, int64_t t, int32_t lat, int32_t lon) {
+    struct block_header *header = (struct block_header *)writer->block;
+
+    memset(writer->block, 0, TRACK_BLOCK_SIZE);
+    header->t_first = header->t_last = t;
+    header->lat_first = lat;
+    header->lon_first = lon;
+    header->count = 1;
+    writer->prev_dt = 0;
+}
+
+// Tambahkan titik ke blok aktif. Mengembalikan 1 jika titik membuka blok baru;
+// isi blok lama (sudah penuh) disalin ke sealed bila tidak NULL.
+static int encode_point(track_writer *writer, int64_t t, int32_t lat, int32_t lon, unsigned char *sealed) {
+    struct block_header *header = (struct block_header *)writer->block;
+    unsigned char *payload = writer->block + sizeof(struct block_header);
+
+    if (header->count > 0) {
+        if (t < writer->prev_t) t = writer->prev_t; // Waktu tidak boleh mundur di dalam blok
+        int64_t dt = t - writer->prev_t;
+        int64_t dod = dt - writer->prev_dt;
+        int64_t dlat = (int64_t)lat - writer->prev_lat;
+        int64_t dlon = (int64_t)lon - writer->prev_lon;
+        int needed = signed_bits(dod) + signed_bits(dlat) + signed_bits(dlon);
+        int fits_32 = dod >= INT32_MIN && dod <= INT32_MAX;
+
+        if (fits_32 && header->bits + needed <= (int)BLOCK_PAYLOAD_BITS && header->count < UINT16_MAX) {
+            put_signed(payload, &header->bits, dod);
+            put_signed(payload, &header->bits, dlat);
+            put_signed(payload, &header->bits, dlon);
+            header->count++;
+            header->t_last = t;
+            writer->prev_t = t;
+            writer->prev_dt = dt;
+            writer->prev_lat = lat;
+            writer->prev_lon = lon;
+            return 0;
+        }
+        if (sealed) memcpy(sealed, writer->block, TRACK_BLOCK_SIZE);
+    }
+
+    start_block(writer, t, lat, lon);
+    writer->prev_t = t;
+    writer->prev_lat = lat;
+    writer->prev_lon = lon;
+    return 1;
+}
+
+static int decode_block(const unsigned char *block, track_point *points) {
+    const struct block_header *header = (const struct block_header *)block;
+    const unsigned char *payload = block + sizeof(struct block_header);
+    uint32_t position = 0;
+    int64_t dt = 0;
+
+    if (header->count == 0 || header->bits > BLOCK_PAYLOAD_BITS || header->count > MAX_BLOCK_POINTS) return 0;
+
+    points[0].t = header->t_first;
+    points[0].lat = header->lat_first;
+    points[0].lon = header->lon_first;
+
+    int count = 1;
+    while (count < header->count && position + 3 <= header->bits) {
+        dt += get_signed(payload, &position);
+        points[count].t = points[count - 1].t + dt;
+        points[count].lat = points[count - 1].lat + (int32_t)get_signed(payload, &position);
+        points[count].lon = points[count - 1].lon + (int32_t)get_signed(payload, &position);
+        count++;
+    }
+    return count;
+}
+
+// ---------------------------------------------------------------------------
+// File per pengguna: data/tracks/<username>.trk berisi blok berukuran tetap
+
+static void track_path(const char *username, char *path, size_t size) {
+    size_t length = snprintf(path, size, "%s/", TRACK_DIR);
+
+    // Karakter di luar [A-Za-z0-9_-] di-escape agar username aman dipakai sebagai nama file
+    for (const unsigned char *p = (const unsigned char *)username; *p && length + 8 < size; p++) {
+        if ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9') || *p == '_' || *p == '-') {
+            path[length++] = *p;
+        } else {
+            length += snprintf(path + length, size - length, "%%%02X", *p);
+        }
+    }
+    snprintf(path + length, size - length, ".trk");
+}
+
+// Buka dan kunci file track; jika file baru saja diganti oleh kompaksi, buka ulang
+static int open_locked(const char *path, int flags, int operation) {
+    while (1) {
+        struct stat st;
+        int fd = open(path, flags, 0644);
+        if (fd < 0) return -1;
+        flock(fd, operation);
+        if (fstat(fd, &st) == 0 && st.st_nlink > 0) return fd;
+        close(fd);
+    }
+}
+
+void track_reset(void) {
+    mkdir(TRACK_DIR, 0755);
+
+    DIR *dir = opendir(TRACK_DIR);
+    if (!dir) return;
+
+    struct dirent *entry;
+    char path[512];
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", TRACK_DIR, entry->d_name);
+        unlink(path);
+    }
+    closedir(dir);
+}
+
+void track_writer_init(track_writer *writer, const char *username) {
+    memset(writer, 0, sizeof(*writer));
+    track_path(username, writer->path, sizeof(writer->path));
+}
+
+// NaN, tak hingga, atau di luar rentang derajat tidak boleh sampai ke lround/int32
+int track_valid_coordinates(double lat, double lon) {
+    return isfinite(lat) && isfinite(lon) && fabs(lat) <= 90.0 && fabs(lon) <= 180.0;
+}
+
+// Simpan satu titik; blok aktif ditulis ulang di posisinya, blok baru ditambahkan di akhir file
+int track_append(track_writer *writer, int64_t t, double lat, double lon) {
+    if (!track_valid_coordinates(lat, lon)) return -1;
+
+    int32_t ilat = (int32_t)lround(lat * TRACK_COORD_SCALE);
+    int32_t ilon = (int32_t)lround(lon * TRACK_COORD_SCALE);
+    int new_block = encode_point(writer, t, ilat, ilon, NULL);
+
+    int fd = open_locked(writer->path, O_RDWR | O_CREAT, LOCK_EX);
+    if (fd < 0) {
+        perror("Failed to open track file");
+        return -1;
+    }
+
+    struct stat st;
+    fstat(fd, &st);
+    off_t offset = st.st_size - st.st_size % TRACK_BLOCK_SIZE;
+    if (!new_block && offset >= TRACK_BLOCK_SIZE) offset -= TRACK_BLOCK_SIZE;
+
+    int result = pwrite(fd, writer->block, TRACK_BLOCK_SIZE, offset) == TRACK_BLOCK_SIZE ? 0 : -1;
+    flock(fd, LOCK_UN);
+    close(fd);
+    return result;
+}
+
+static int read_block(int fd, long index, unsigned char *block) {
+    flock(fd, LOCK_SH);
+    ssize_t n = pread(fd, block, TRACK_BLOCK_SIZE, index * TRACK_BLOCK_SIZE);
+    flock(fd, LOCK_UN);
+    return n == TRACK_BLOCK_SIZE ? 0 : -1;
+}
+
+// Alirkan titik milik username dalam rentang [from, to] ke callback, urut waktu.
+// Jika titik lebih banyak dari max_points (> 0), diambil setiap titik ke-n secara merata.
+long track_query(const char *username, int64_t from, int64_t to, long max_points, track_callback callback, void *context) {
+    char path[256];
+    uint64_t storage[TRACK_BLOCK_SIZE / sizeof(uint64_t)];
+    unsigned char *block = (unsigned char *)storage;
+    track_point *points = malloc(MAX_BLOCK_POINTS * sizeof(track_point));
+    struct stat st;
+
+    track_path(username, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || !points) {
+        if (fd >= 0) close(fd);
+        free(points);
+        return 0;
+    }
+    fstat(fd, &st);
+    long nblocks = st.st_size / TRACK_BLOCK_SIZE;
+
+    // Putaran pertama: hitung titik dalam rentang, blok di luar rentang dilewati lewat header
+    long total = 0;
+    for (long i = 0; i < nblocks; i++) {
+        const struct block_header *header = (const struct block_header *)block;
+        if (read_block(fd, i, block) < 0) break;
+        if (header->count == 0 || header->t_last < from || header->t_first > to) continue;
+        if (header->t_first >= from && header->t_last <= to) {
+            total += header->count;
+            continue;
+        }
+        int count = decode_block(block, points);
+        for (int j = 0; j < count; j++) {
+            if (points[j].t >= from && points[j].t <= to) total++;
+        }
+    }
+
+    long stride = (max_points > 0 && total > max_points) ? (total + max_points - 1) / max_points : 1;
+    long index = 0, emitted = 0;
+
+    // Putaran kedua: decode dan kirim titik terpilih blok demi blok
+    for (long i = 0; i < nblocks && index < total; i++) {
+        const struct block_header *header = (const struct block_header *)block;
+        if (read_block(fd, i, block) < 0) break;
+        if (header->count == 0 || header->t_last < from || header->t_first > to) continue;
+
+        int count = decode_block(block, points);
+        for (int j = 0; j < count && index < total; j++) {
+            if (points[j].t < from || points[j].t > to) continue;
+            if (index++ % stride == 0) {
+                callback(&points[j], context);
+                emitted++;
+            }
+        }
+    }
+
+    close(fd);
+    free(points);
+    return emitted;
+}
+
+// ---------------------------------------------------------------------------
+// Tier downsampling: blok lama disederhanakan dengan Douglas-Peucker
+
+static double segment_distance_m(const track_point *p, const track_point *a, const track_point *b, double lon_scale) {
+    double ax = a->lon * lon_scale, ay = a->lat * METERS_PER_MICRODEGREE;
+    double bx = b->lon * lon_scale, by = b->lat * METERS_PER_MICRODEGREE;
+    double px = p->lon * lon_scale, py = p->lat * METERS_PER_MICRODEGREE;
+    double dx = bx - ax, dy = by - ay;
+    double length_sq = dx * dx + dy * dy;
+
+    if (length_sq == 0) return hypot(px - ax, py - ay);
+    double u = ((px - ax) * dx + (py - ay) * dy) / length_sq;
+    if (u < 0) u = 0;
+    if (u > 1) u = 1;
+    return hypot(px - (ax + u * dx), py - (ay + u * dy));
+}
+
+// Tandai titik yang dipertahankan; iteratif dengan stack agar track panjang tidak menghabiskan stack
+static void douglas_peucker(const track_point *points, size_t count, double epsilon_m, unsigned char *keep) {
+    if (count == 0) return;
+
+    size_t *stack = malloc(count * 2 * sizeof(size_t));
+    double lon_scale = METERS_PER_MICRODEGREE * cos(points[0].lat / TRACK_COORD_SCALE * M_PI / 180.0);
+    size_t top = 0;
+
+    memset(keep, 0, count);
+    keep[0] = keep[count - 1] = 1;
+    if (!stack) {
+        memset(keep, 1, count);
+        return;
+    }
+
+    stack[top++] = 0;
+    stack[top++] = count - 1;
+    while (top > 0) {
+        size_t end = stack[--top], start = stack[--top];
+        double max_distance = 0;
+        size_t farthest = start;
+
+        for (size_t i = start + 1; i < end; i++) {
+            double distance = segment_distance_m(&points[i], &points[start], &points[end], lon_scale);
+            if (distance > max_distance) {
+                max_distance = distance;
+                farthest = i;
+            }
+        }
+        if (max_distance > epsilon_m) {
+            keep[farthest] = 1;
+            stack[top++] = start;
+            stack[top++] = farthest;
+            stack[top++] = farthest;
+            stack[top++] = end;
+        }
+    }
+    free(stack);
+}
+
+// Sederhanakan satu rangkaian titik lalu encode ulang ke out; mengembalikan jumlah blok tertulis
+static long downsample_run(const track_point *points, size_t count, double epsilon_m, unsigned char *out) {
+    unsigned char *keep = malloc(count);
+    track_writer encoder;
+    long nblocks = 0;
+
+    if (!keep) return -1;
+    douglas_peucker(points, count, epsilon_m, keep);
+
+    memset(&encoder, 0, sizeof(encoder));
+    for (size_t i = 0; i < count; i++) {
+        if (!keep[i]) continue;
+        unsigned char *sealed = out + nblocks * TRACK_BLOCK_SIZE;
+        int had_points = ((struct block_header *)encoder.block)->count > 0;
+        if (encode_point(&encoder, points[i].t, points[i].lat, points[i].lon, sealed) && had_points) {
+            ((struct block_header *)sealed)->flags |= BLOCK_DOWNSAMPLED;
+            nblocks++;
+        }
+    }
+    ((struct block_header *)encoder.block)->flags |= BLOCK_DOWNSAMPLED;
+    memcpy(out + nblocks * TRACK_BLOCK_SIZE, encoder.block, TRACK_BLOCK_SIZE);
+
+    free(keep);
+    return nblocks + 1;
+}
+
+static int is_compactable(const unsigned char *block, int64_t older_than) {
+    const struct block_header *header = (const struct block_header *)block;
+    return header->count > 0 && !(header->flags & BLOCK_DOWNSAMPLED) && header->t_last < older_than;
+}
+
+// Downsample blok yang lebih tua dari older_than. Blok terakhir tidak pernah disentuh
+// karena masih menjadi blok aktif milik proses penulis.
+int track_compact(const char *path, int64_t older_than, double epsilon_m) {
+    struct stat st;
+    int result = 0;
+
+    int fd = open_locked(path, O_RDWR, LOCK_EX);
+    if (fd < 0) return -1;
+    fstat(fd, &st);
+
+    long nblocks = st.st_size / TRACK_BLOCK_SIZE;
+    unsigned char *input = malloc(nblocks * TRACK_BLOCK_SIZE + 1);
+    unsigned char *output = NULL;
+    track_point *points = NULL;
+
+    int eligible = 0;
+    size_t total_points = 0;
+    if (input && nblocks > 1 && pread(fd, input, nblocks * TRACK_BLOCK_SIZE, 0) == nblocks * TRACK_BLOCK_SIZE) {
+        for (long i = 0; i < nblocks - 1; i++) {
+            if (!is_compactable(input + i * TRACK_BLOCK_SIZE, older_than)) continue;
+            eligible = 1;
+            total_points += ((struct block_header *)(input + i * TRACK_BLOCK_SIZE))->count;
+        }
+    }
+
+    // Encode ulang bisa memecah blok di posisi berbeda, jadi sediakan ruang cadangan
+    if (eligible) {
+        output = malloc(nblocks * 2 * TRACK_BLOCK_SIZE);
+        points = malloc((total_points + 1) * sizeof(track_point));
+        if (!output || !points) eligible = 0;
+    }
+
+    if (eligible) {
+        long written = 0;
+        for (long i = 0; i < nblocks && result == 0;) {
+            if (i == nblocks - 1 || !is_compactable(input + i * TRACK_BLOCK_SIZE, older_than)) {
+                memcpy(output + written * TRACK_BLOCK_SIZE, input + i * TRACK_BLOCK_SIZE, TRACK_BLOCK_SIZE);
+                written++;
+                i++;
+                continue;
+            }
+
+            // Gabungkan blok-blok lama yang berurutan menjadi satu rangkaian sebelum disederhanakan
+            size_t count = 0;
+            while (i < nblocks - 1 && is_compactable(input + i * TRACK_BLOCK_SIZE, older_than)) {
+                count += decode_block(input + i * TRACK_BLOCK_SIZE, points + count);
+                i++;
+            }
+            long n = downsample_run(points, count, epsilon_m, output + written * TRACK_BLOCK_SIZE);
+            if (n < 0) result = -1;
+            else written += n;
+        }
+
+        // Tulis ke file sementara lalu rename; penulis yang menunggu lock akan membuka ulang file
+        char tmp_path[300];
+        snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+        int tmp_fd = result == 0 ? open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+        if (tmp_fd >= 0) {
+            ssize_t size = written * TRACK_BLOCK_SIZE;
+            int ok = write(tmp_fd, output, size) == size && fsync(tmp_fd) == 0;
+            close(tmp_fd);
+            if (!ok || rename(tmp_path, path) < 0) {
+                unlink(tmp_path);
+                result = -1;
+            }
+        } else {
+            result = -1;
+        }
+    }
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    free(input);
+    free(output);
+    free(points);
+    return result;
+}
+
+// Proses latar belakang milik server lokasi untuk tier downsampling
+// stop dicek di antara file; file yang sedang dikompaksi selalu diselesaikan dulu
+void track_compact_loop(const volatile sig_atomic_t *stop) {
+    while (!*stop) {
+        sleep(TRACK_COMPACT_INTERVAL);
+
+        DIR *dir = opendir(TRACK_DIR);
+        if (!dir) continue;
+
+        struct dirent *entry;
+        char path[512];
+        int64_t older_than = track_now_ms() - TRACK_COMPACT_AGE_MS;
+        while (!*stop && (entry = readdir(dir)) != NULL) {
+            size_t length = strlen(entry->d_name);
+            if (length < 4 || strcmp(entry->d_name + length - 4, ".trk") != 0) continue;
+            snprintf(path, sizeof(path), "%s/%s", TRACK_DIR, entry->d_name);
+            track_compact(path, older_than, TRACK_DP_EPSILON_M);
+        }
+        closedir(dir);
+    }
+}
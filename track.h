@@ -0,0 +1,40 @@
+#ifndef TRACK_H
+#define TRACK_H
+
+#include <stdint.h>
+#include <signal.h>
+
+#define TRACK_DIR "data/tracks"
+#define TRACK_BLOCK_SIZE 512                    // Ukuran tetap setiap blok di file .trk
+#define TRACK_COORD_SCALE 1000000.0             // Koordinat disimpan dalam mikroderajat (~11 cm)
+#define TRACK_COMPACT_INTERVAL 60               // Detik antar putaran downsampling
+#define TRACK_COMPACT_AGE_MS (60 * 60 * 1000L)  // Blok lebih tua dari ini ikut di-downsample
+#define TRACK_DP_EPSILON_M 5.0                  // Toleransi Douglas-Peucker dalam meter
+
+typedef struct {
+    int64_t t;   // Milidetik sejak epoch
+    int32_t lat; // Mikroderajat
+    int32_t lon;
+} track_point;
+
+// State encoder untuk satu pengguna; blok aktif disimpan di memori dan ditulis ulang di akhir file
+typedef struct {
+    char path[256];
+    unsigned char block[TRACK_BLOCK_SIZE];
+    int64_t prev_t, prev_dt;
+    int32_t prev_lat, prev_lon;
+} track_writer;
+
+typedef void (*track_callback)(const track_point *point, void *context);
+
+// Deklarasi fungsi yang ada di track.c
+void track_reset(void);
+void track_writer_init(track_writer *writer, const char *username);
+int track_valid_coordinates(double lat, double lon);
+int track_append(track_writer *writer, int64_t t, double lat, double lon);
+long track_query(const char *username, int64_t from, int64_t to, long max_points, track_callback callback, void *context);
+int track_compact(const char *path, int64_t older_than, double epsilon_m);
+void track_compact_loop(const volatile sig_atomic_t *stop);
+int64_t track_now_ms(void);
+
+#endif
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "upgrade.h"
+
+static void socket_path(int port, struct sockaddr_un *address) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    snprintf(address->sun_path, sizeof(address->sun_path), UPGRADE_SOCKET_FILE, port);
+}
+
+// Dibuat oleh proses baru sebelum memberi sinyal ke proses lama
+int upgrade_listen(int port) {
+    struct sockaddr_un address;
+    socket_path(port, &address);
+    unlink(address.sun_path);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+    if (bind(sock, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(sock, SOMAXCONN) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+int upgrade_connect(int port) {
+    struct sockaddr_un address;
+    socket_path(port, &address);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+    if (connect(sock, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// Header pesan: 1 byte jenis + 4 byte panjang payload (network order), dikirim bersama fd
+int upgrade_send(int sock, char type, int fd, const char *payload, size_t length) {
+    unsigned char header[5];
+    uint32_t net_length = htonl((uint32_t)length);
+    header[0] = (unsigned char)type;
+    memcpy(header + 1, &net_length, sizeof(net_length));
+
+    union {
+        struct cmsghdr align;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct iovec part = { header, sizeof(header) };
+    struct msghdr msg = { .msg_iov = &part, .msg_iovlen = 1, .msg_control = control.buffer, .msg_controllen = sizeof(control.buffer) };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    if (sendmsg(sock, &msg, MSG_NOSIGNAL) != sizeof(header)) return -1;
+
+    size_t sent = 0;
+    while (sent < length) {
+        ssize_t result = send(sock, payload + sent, length - sent, MSG_NOSIGNAL);
+        if (result <= 0) return -1;
+        sent += result;
+    }
+    return 0;
+}
+
+// Terima satu pesan. payload dialokasikan dengan malloc dan selalu diakhiri '\0'.
+int upgrade_recv(int sock, char *type, int *fd, char **payload) {
+    unsigned char header[5];
+    union {
+        struct cmsghdr align;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    struct iovec part = { header, sizeof(header) };
+    struct msghdr msg = { .msg_iov = &part, .msg_iovlen = 1, .msg_control = control.buffer, .msg_controllen = sizeof(control.buffer) };
+    if (recvmsg(sock, &msg, MSG_WAITALL) != sizeof(header)) return -1;
+
+    *fd = -1;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    if (*fd < 0) return -1;
+
+    uint32_t net_length;
+    memcpy(&net_length, header + 1, sizeof(net_length));
+    size_t length = ntohl(net_length);
+    *type = (char)header[0];
+
+    *payload = malloc(length + 1);
+    if (!*payload) {
+        close(*fd);
+        return -1;
+    }
+    size_t received = 0;
+    while (received < length) {
+        ssize_t result = recv(sock, *payload + received, length - received, 0);
+        if (result <= 0) {
+            free(*payload);
+            close(*fd);
+            return -1;
+        }
+        received += result;
+    }
+    (*payload)[length] = '\0';
+    return 0;
+}
+
+// Proses utama memegang lock fcntl pada pid file selama hidup. Lock ini tidak diwarisi
+// anak hasil fork dan lepas sendiri saat proses mati, jadi fd-nya sengaja tidak ditutup.
+// wait_sec memberi waktu proses lama melepas lock-nya saat upgrade.
+int upgrade_write_pid(int port, int wait_sec) {
+    char path[64], text[16];
+    snprintf(path, sizeof(path), UPGRADE_PID_FILE, port);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+
+    struct flock lock = { .l_type = F_WRLCK, .l_whence = SEEK_SET };
+    time_t deadline = time(NULL) + wait_sec;
+    while (fcntl(fd, F_SETLK, &lock) < 0) {
+        if (time(NULL) >= deadline) {
+            close(fd);
+            return -1;
+        }
+        usleep(10000);
+    }
+
+    int length = snprintf(text, sizeof(text), "%d\n", (int)getpid());
+    if (ftruncate(fd, 0) < 0 || pwrite(fd, text, length, 0) != length) {
+        close(fd);
+        return -1;
+    }
+    return 0;
+}
+
+// Return pid proses utama yang masih memegang lock pid file, atau -1 jika tidak ada.
+// Isi file saja tidak dipercaya: pid server yang sudah mati bisa dipakai proses lain.
+pid_t upgrade_read_pid(int port) {
+    char path[64];
+    snprintf(path, sizeof(path), UPGRADE_PID_FILE, port);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct flock lock = { .l_type = F_WRLCK, .l_whence = SEEK_SET };
+    pid_t pid = -1;
+    if (fcntl(fd, F_GETLK, &lock) == 0 && lock.l_type != F_UNLCK) pid = lock.l_pid;
+    close(fd);
+    return pid;
+}
+
+// Data biner (buffer parser, frame yang belum terkirim) dibawa dalam JSON sebagai hex
+char *upgrade_hex_encode(const void *data, size_t length) {
+    static const char digits[] = "0123456789abcdef";
+    const unsigned char *bytes = data;
+    char *hex = malloc(length * 2 + 1);
+    if (!hex) return NULL;
+
+    for (size_t i = 0; i < length; i++) {
+        hex[i * 2] = digits[bytes[i] >> 4];
+        hex[i * 2 + 1] = digits[bytes[i] & 0xF];
+    }
+    hex[length * 2] = '\0';
+    return hex;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Return jumlah byte hasil decode, atau -1 jika hex tidak valid atau tidak muat
+long upgrade_hex_decode(const char *hex, void *data, size_t size) {
+    unsigned char *bytes = data;
+    size_t length = strlen(hex);
+    if (length % 2 != 0 || length / 2 > size) return -1;
+
+    for (size_t i = 0; i < length / 2; i++) {
+        int high = hex_value(hex[i * 2]), low = hex_value(hex[i * 2 + 1]);
+        if (high < 0 || low < 0) return -1;
+        bytes[i] = (unsigned char)(high << 4 | low);
+    }
+    return (long)(length / 2);
+}
@@ -0,0 +1,27 @@
+#ifndef UPGRADE_H
+#define UPGRADE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define UPGRADE_PID_FILE "data/server.%d.pid"      // Diisi nomor port
+#define UPGRADE_SOCKET_FILE "data/upgrade.%d.sock" // Unix socket tempat proses baru menerima fd
+#define UPGRADE_WAIT_SEC 5       // Batas menunggu soket listen dari proses lama
+#define UPGRADE_WINDOW_SEC 30    // Lama proses baru menerima koneksi pindahan
+#define UPGRADE_HANDOFF_SEC 10   // Koneksi lama yang belum pindah setelah ini ditutup dengan 1001
+
+// Jenis pesan di upgrade socket; setiap pesan membawa satu fd lewat SCM_RIGHTS
+#define UPGRADE_LISTENER 'L'     // Soket listen, tanpa payload
+#define UPGRADE_CONNECTION 'C'   // Soket klien, payload berupa state koneksi (JSON)
+
+// Deklarasi fungsi yang ada di upgrade.c
+int upgrade_listen(int port);
+int upgrade_connect(int port);
+int upgrade_send(int sock, char type, int fd, const char *payload, size_t length);
+int upgrade_recv(int sock, char *type, int *fd, char **payload);
+int upgrade_write_pid(int port, int wait_sec);
+pid_t upgrade_read_pid(int port);
+char *upgrade_hex_encode(const void *data, size_t length);
+long upgrade_hex_decode(const char *hex, void *data, size_t size);
+
+#endif
@@ -67,6 +67,31 @@ int websocket_encode(const char *message, char *frame) {
     return frame_length;
 }
 
+// Function to encode WebSocket close frame (status code + optional reason)
+int websocket_encode_close(unsigned short code, const char *reason, char *frame) {
+    size_t reason_length = reason ? strlen(reason) : 0;
+    if (reason_length > 123) reason_length = 123; // Control frame payload max 125 bytes
+
+    frame[0] = 0x88; // FIN = 1, opcode = 0x8 (close)
+    frame[1] = 2 + reason_length;
+    frame[2] = (code >> 8) & 0xFF;
+    frame[3] = code & 0xFF;
+    if (reason_length) memcpy(frame + 4, reason, reason_length);
+
+    return 4 + reason_length;
+}
+
+// Function to encode WebSocket control frame (ping/pong), payload max 125 bytes
+int websocket_encode_control(int opcode, const char *payload, size_t length, char *frame) {
+    if (length > 125) length = 125;
+
+    frame[0] = 0x80 | opcode;
+    frame[1] = length;
+    if (length) memcpy(frame + 2, payload, length);
+
+    return 2 + length;
+}
+
 // Function to decode WebSocket frame
 int websocket_decode(char *frame, char *message) {
     unsigned char *payload = (unsigned char*) frame;
@@ -128,3 +153,84 @@ int handle_handshake(int client_fd, char *buffer) {
     printf("Invalid handshake request\n");
     return -1;
 }
+
+// Baca header frame di awal buffer reader.
+// Mengembalikan 1 jika header lengkap (panjang header, mask, dan payload diisi), 0 jika perlu data lagi
+static int frame_header(const ws_reader *reader, size_t *offset, size_t *mask_length, size_t *payload_length) {
+    const unsigned char *data = reader->data;
+
+    if (reader->length < 2) return 0;
+    *offset = 2;
+    *payload_length = data[1] & 0x7F;
+    if (*payload_length == 126) {
+        if (reader->length < 4) return 0;
+        *payload_length = (data[2] << 8) | data[3];
+        *offset = 4;
+    } else if (*payload_length == 127) {
+        if (reader->length < 10) return 0;
+        *payload_length = 0;
+        for (int i = 0; i < 8; i++) {
+            *payload_length = (*payload_length << 8) | data[2 + i];
+        }
+        *offset = 10;
+    }
+
+    *mask_length = (data[1] & 0x80) ? 4 : 0;
+    return 1;
+}
+
+// Ambil satu frame utuh dari buffer reader.
+// Mengembalikan 1 jika frame tersedia, 0 jika perlu data lagi, -1 jika frame tidak valid/terlalu besar
+static int parse_frame(ws_reader *reader, int *opcode, char *message, size_t size, size_t *message_length) {
+    unsigned char *data = reader->data;
+    size_t payload_length, offset, mask_length;
+
+    if (!frame_header(reader, &offset, &mask_length, &payload_length)) return 0;
+    if (payload_length >= size || offset + mask_length + payload_length > sizeof(reader->data)) return -1;
+
+    size_t frame_length = offset + mask_length + payload_length;
+    if (reader->length < frame_length) return 0;
+
+    unsigned char *masking_key = data + offset;
+    unsigned char *payload_data = data + offset + mask_length;
+    for (size_t i = 0; i < payload_length; i++) {
+        message[i] = mask_length ? payload_data[i] ^ masking_key[i % 4] : payload_data[i];
+    }
+    message[payload_length] = '\0';
+    *opcode = data[0] & 0x0F;
+    *message_length = payload_length;
+
+    // Sisa data (awal frame berikutnya) digeser ke depan buffer
+    memmove(data, data + frame_length, reader->length - frame_length);
+    reader->length -= frame_length;
+    return 1;
+}
+
+// Cek apakah buffer sudah berisi satu frame utuh, sehingga websocket_read_frame tidak akan memblokir.
+// Frame yang tidak valid juga dianggap siap agar langsung ditolak oleh websocket_read_frame.
+int websocket_frame_ready(const ws_reader *reader) {
+    size_t payload_length, offset, mask_length;
+
+    if (!frame_header(reader, &offset, &mask_length, &payload_length)) return 0;
+    if (offset + mask_length + payload_length > sizeof(reader->data)) return 1;
+    return reader->length >= offset + mask_length + payload_length;
+}
+
+// Function to read one complete WebSocket frame; returns payload length or -1 on close/error.
+// Paling banyak satu recv per panggilan: jika frame belum utuh, return WS_READ_AGAIN
+// agar pemanggil bisa kembali ke poll dan tidak tertahan klien yang mengirim setengah frame.
+int websocket_read_frame(int fd, ws_reader *reader, int *opcode, char *message, size_t size) {
+    size_t message_length;
+
+    int result = parse_frame(reader, opcode, message, size, &message_length);
+    if (result > 0) return message_length;
+    if (result < 0) return -1;
+
+    ssize_t bytes_received = recv(fd, reader->data + reader->length, sizeof(reader->data) - reader->length, 0);
+    if (bytes_received <= 0) return -1;
+    reader->length += bytes_received;
+
+    result = parse_frame(reader, opcode, message, size, &message_length);
+    if (result > 0) return message_length;
+    return result < 0 ? -1 : WS_READ_AGAIN;
+}
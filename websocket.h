@@ -2,12 +2,35 @@
 #define WEBSOCKET_H
 #define MAX_BUFFER_SIZE 1024  // Definisikan makro di sini
 
+#include <stddef.h>
+
+#define WS_OPCODE_TEXT 0x1
+#define WS_OPCODE_CLOSE 0x8
+#define WS_OPCODE_PING 0x9
+#define WS_OPCODE_PONG 0xA
+
+#define WS_READ_AGAIN -2  // websocket_read_frame: frame belum utuh, tunggu data berikutnya
+
+#define WS_CLOSE_NORMAL 1000
+#define WS_CLOSE_GOING_AWAY 1001
+#define WS_CLOSE_POLICY_VIOLATION 1008
+
+// Buffer pembacaan: satu recv bisa berisi beberapa frame atau hanya sebagian frame
+typedef struct {
+    unsigned char data[2 * MAX_BUFFER_SIZE];
+    size_t length;
+} ws_reader;
+
 
 // Deklarasi fungsi yang ada di websocket.c
 char* base64_encode(const unsigned char *data, size_t len);
 char* get_websocket_accept_key(const char* sec_websocket_key);
 int websocket_encode(const char *message, char *frame);
+int websocket_encode_close(unsigned short code, const char *reason, char *frame);
+int websocket_encode_control(int opcode, const char *payload, size_t length, char *frame);
 int websocket_decode(char *frame, char *message);
+int websocket_frame_ready(const ws_reader *reader);
+int websocket_read_frame(int fd, ws_reader *reader, int *opcode, char *message, size_t size);
 int handle_handshake(int client_fd, char *buffer);
 
 #endif